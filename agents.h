@@ -0,0 +1,168 @@
+#ifndef AGENTS_H
+#define AGENTS_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "orderbook.h"
+#include "philox.h"
+
+// A large population of simple value traders, stored column by column (struct of arrays)
+// so one simulation tick is a few straight passes over plain int arrays instead of a
+// virtual call per agent. Every agent values the stock at the shared fundamental plus
+// its own bias; when it wakes up it buys if that value beats the mid price by more than
+// its threshold, sells if the mid beats it by as much, and sleeps for its interval.
+// Inventory limits keep positions bounded.
+//
+// decide() is written without branches (comparisons become 0/1 and are combined with &)
+// over same-width int32 columns, in fixed blocks of `lanes` agents with no aliasing, so
+// the compiler turns each block into SIMD code at plain -O2. The columns are padded to a
+// whole number of blocks with agents that never wake up. Only the few agents that act reach
+// collectOrders(), which builds their orders for the book; the book never sees the rest.
+//
+// Agent parameters come from the agent's own Philox stream (philox.h) keyed by its
+// index, so a population is the same whatever size it is split into.
+
+struct AgentConfig {
+    uint64_t seed = 1;
+    int32_t maxBias = 50;        // Valuation bias, +- ticks
+    int32_t minThreshold = 2;    // Edge needed to trade, ticks
+    int32_t maxThreshold = 40;
+    int32_t maxAggression = 5;   // How far past the mid an agent will pay, ticks
+    int32_t maxSize = 100;       // Order size, shares
+    int32_t minInterval = 20;    // Ticks between wake-ups
+    int32_t maxInterval = 2000;
+    int32_t maxInventory = 500;  // Position limit, shares either way
+};
+
+class AgentPopulation {
+    static constexpr size_t lanes = 64;
+
+    AgentConfig config;
+    size_t agents;
+    std::vector<int32_t> bias;
+    std::vector<int32_t> threshold;
+    std::vector<int32_t> aggression;
+    std::vector<int32_t> size;
+    std::vector<int32_t> interval;
+    std::vector<int32_t> nextWake;
+    std::vector<int32_t> inventory;
+    std::vector<int32_t> lastOrderTick;  // -1 if the agent has no order out
+    std::vector<int32_t> action;         // Output of decide(): 1 buy, -1 sell, 0 nothing
+    std::vector<double> cash;
+    std::vector<size_t> activeBlocks;    // Blocks with at least one agent acting this tick
+
+public:
+    AgentPopulation(size_t count, const AgentConfig& agentConfig) : config(agentConfig), agents(count) {
+        size_t padded = (count + lanes - 1) / lanes * lanes;
+        for (auto* column : {&bias, &threshold, &aggression, &size, &interval, &inventory, &action}) {
+            column->assign(padded, 0);
+        }
+        nextWake.assign(padded, std::numeric_limits<int32_t>::max());
+        lastOrderTick.assign(padded, -1);
+        cash.assign(padded, 0.0);
+        for (size_t i = 0; i < count; ++i) {
+            PhiloxStream rng(config.seed, i + 1);  // Stream 0 is left for the market itself
+            bias[i] = draw(rng, -config.maxBias, config.maxBias);
+            threshold[i] = draw(rng, config.minThreshold, config.maxThreshold);
+            aggression[i] = draw(rng, 0, config.maxAggression);
+            size[i] = draw(rng, 1, config.maxSize);
+            interval[i] = draw(rng, config.minInterval, config.maxInterval);
+            nextWake[i] = draw(rng, 0, interval[i] - 1);  // Spread the first wake-ups out
+        }
+    }
+
+    size_t count() const { return agents; }
+
+    // Decides every agent's action for this tick; returns how many act
+    size_t decide(int32_t tick, int32_t valueTicks, int32_t midTicks) {
+        size_t acting = 0;
+        activeBlocks.clear();
+        for (size_t first = 0; first < bias.size(); first += lanes) {
+            size_t inBlock = decideBlock(bias.data() + first, threshold.data() + first, size.data() + first,
+                                         interval.data() + first, inventory.data() + first, nextWake.data() + first,
+                                         action.data() + first, tick, valueTicks - midTicks, config.maxInventory);
+            if (inBlock > 0) activeBlocks.push_back(first);
+            acting += inBlock;
+        }
+        return acting;
+    }
+
+    // Appends the orders of the agents decide() picked, in agent order, looking only at
+    // the blocks where someone acts
+    void collectOrders(int32_t tick, int32_t valueTicks, int32_t midTicks, std::vector<Order>& orders) {
+        for (size_t first : activeBlocks) {
+            for (size_t i = first; i < first + lanes; ++i) {
+                if (action[i] != 0) addOrders(i, tick, valueTicks, midTicks, orders);
+            }
+        }
+    }
+
+    // Books a fill against the agents involved (ids from collectOrders)
+    void applyFill(const Fill& fill) {
+        size_t buyer, seller;
+        if (agentOf(fill.buyId, buyer)) {
+            inventory[buyer] += fill.quantity;
+            cash[buyer] -= fill.quantity * fill.price;
+        }
+        if (agentOf(fill.sellId, seller)) {
+            inventory[seller] -= fill.quantity;
+            cash[seller] += fill.quantity * fill.price;
+        }
+    }
+
+    int32_t inventoryOf(size_t agent) const { return inventory[agent]; }
+    double cashOf(size_t agent) const { return cash[agent]; }
+
+    static std::string orderId(size_t agent, int32_t tick) {
+        return "a" + std::to_string(agent) + "." + std::to_string(tick);
+    }
+
+private:
+    // One block of agents: the SIMD kernel
+    static size_t decideBlock(const int32_t* __restrict bias, const int32_t* __restrict threshold,
+                              const int32_t* __restrict size, const int32_t* __restrict interval,
+                              const int32_t* __restrict inventory, int32_t* __restrict wake,
+                              int32_t* __restrict action, int32_t tick, int32_t edgeBase, int32_t limit) {
+        int32_t acting = 0;
+        for (size_t i = 0; i < lanes; ++i) {
+            int32_t awake = wake[i] <= tick;
+            int32_t edge = edgeBase + bias[i];
+            int32_t buy = awake & (edge > threshold[i]) & (inventory[i] + size[i] <= limit);
+            int32_t sell = awake & (-edge > threshold[i]) & (inventory[i] - size[i] >= -limit);
+            action[i] = buy - sell;
+            wake[i] += awake * (tick + interval[i] - wake[i]);
+            acting += buy | sell;
+        }
+        return static_cast<size_t>(acting);
+    }
+
+    // A cancel of the agent's previous order if it had one out, then a limit order at its
+    // value, capped at its aggression past the mid
+    void addOrders(size_t i, int32_t tick, int32_t valueTicks, int32_t midTicks, std::vector<Order>& orders) {
+        if (lastOrderTick[i] >= 0) {
+            orders.push_back(Order{orderId(i, lastOrderTick[i]), 'C', 0, 0.0, false, tick});
+        }
+        int32_t value = valueTicks + bias[i];
+        int32_t price = action[i] > 0 ? std::min(value, midTicks + aggression[i])
+                                      : std::max(value, midTicks - aggression[i]);
+        orders.push_back(Order{orderId(i, tick), action[i] > 0 ? 'B' : 'S', size[i], std::max(price, 1) / 100.0,
+                               false, tick});
+        lastOrderTick[i] = tick;
+    }
+
+    static int32_t draw(PhiloxStream& rng, int32_t low, int32_t high) {
+        return low + static_cast<int32_t>(rng() % static_cast<uint64_t>(high - low + 1));
+    }
+
+    bool agentOf(const std::string& id, size_t& agent) const {
+        if (id.size() < 2 || id[0] != 'a') return false;
+        agent = std::strtoull(id.c_str() + 1, nullptr, 10);
+        return agent < agents;
+    }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "orderbook.h"
+#include "agents.h"
+#include "philox.h"
+#include "trade_store.h"
+#include "tsc_clock.h"
+
+// Agent-based simulation: a population of value traders (agents.h) around a random-walk
+// fundamental, trading through one OrderBook.
+//   ./agentsim <agents> <ticks> [seed] [initial_price]
+// Each tick the fundamental moves, every agent is evaluated in one SIMD pass, and only
+// the orders of the agents that act are submitted to the book, as one batch. Reports the
+// session and how the time splits between the decision kernel and the book.
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 5) {
+        std::cerr << "Usage: ./agentsim <agents> <ticks> [seed] [initial_price]\n";
+        return 1;
+    }
+    size_t agentCount = std::strtoull(argv[1], nullptr, 10);
+    int32_t ticks = std::atoi(argv[2]);
+    AgentConfig config;
+    config.seed = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1;
+    double initialPrice = argc > 4 ? std::atof(argv[4]) : 100.0;
+    if (agentCount == 0 || ticks <= 0 || initialPrice <= 0) {
+        std::cerr << "Error: agents, ticks and price must be positive\n";
+        return 1;
+    }
+
+    uint64_t started = TscClock::now();
+    AgentPopulation agents(agentCount, config);
+    double setupSeconds = TscClock::seconds(TscClock::nowOrdered() - started);
+
+    OrderBook orderBook(initialPrice);
+    orderBook.setMutationTracking(false);
+    TradeStore tape;
+    tape.attach(orderBook);
+    orderBook.addFillListener([&agents](const Fill& fill) { agents.applyFill(fill); });
+
+    PhiloxStream market(config.seed, 0);
+    int32_t valueTicks = static_cast<int32_t>(std::llround(initialPrice * 100.0));
+    std::vector<Order> batch;
+    std::ostream discard(nullptr);
+    uint64_t kernelTicks = 0, bookTicks = 0;
+    long long acted = 0, submitted = 0;
+    for (int32_t tick = 1; tick <= ticks; ++tick) {
+        valueTicks = std::max<int32_t>(1, valueTicks + static_cast<int32_t>(market() % 5) - 2);
+        long long bidTicks, askTicks, quantity;
+        bool hasBid = orderBook.bestBid(bidTicks, quantity), hasAsk = orderBook.bestAsk(askTicks, quantity);
+        int32_t midTicks = static_cast<int32_t>(
+            hasBid && hasAsk ? (bidTicks + askTicks) / 2 : std::llround(orderBook.getLastTradedPrice() * 100.0));
+
+        uint64_t kernelStarted = TscClock::now();
+        acted += agents.decide(tick, valueTicks, midTicks);
+        batch.clear();
+        agents.collectOrders(tick, valueTicks, midTicks, batch);
+        uint64_t bookStarted = TscClock::nowOrdered();
+        orderBook.submitBatch(batch.data(), batch.size(), discard);
+        uint64_t bookDone = TscClock::nowOrdered();
+        kernelTicks += bookStarted - kernelStarted;
+        bookTicks += bookDone - bookStarted;
+        submitted += static_cast<long long>(batch.size());
+    }
+
+    double kernelSeconds = TscClock::seconds(kernelTicks), bookSeconds = TscClock::seconds(bookTicks);
+
+    // Every share bought was sold by another agent
+    long long netInventory = 0, grossInventory = 0;
+    double netCash = 0.0;
+    for (size_t i = 0; i < agents.count(); ++i) {
+        netInventory += agents.inventoryOf(i);
+        grossInventory += std::abs(agents.inventoryOf(i));
+        netCash += agents.cashOf(i);
+    }
+    TradeStats session = tape.summarize();
+    std::cout << agentCount << " agents over " << ticks << " ticks: " << acted << " decisions to trade, "
+              << submitted << " messages to the book\n";
+    std::cout << "Trades: " << session.count << "  Volume: " << session.volume << "  VWAP: "
+              << formatPrice(session.vwap()) << "  Last: " << formatPrice(orderBook.getLastTradedPrice())
+              << "  Fundamental: " << formatPrice(valueTicks / 100.0) << "  Resting: " << orderBook.openOrderCount()
+              << "\n";
+    std::cout << "Net inventory " << netInventory << " (gross " << grossInventory << "), net cash "
+              << formatPrice(netCash) << "\n";
+    std::cout << "Setup " << setupSeconds << "s, decision kernel " << kernelSeconds << "s ("
+              << kernelSeconds * 1e9 / (static_cast<double>(agentCount) * ticks) << " ns per agent-tick), book "
+              << bookSeconds << "s (" << orderBook.passiveBatchCount() << " orders inserted without matching)\n";
+    return 0;
+}
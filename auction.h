@@ -0,0 +1,232 @@
+#ifndef AUCTION_H
+#define AUCTION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+// Result of an auction: the single price everything crosses at, the volume that
+// executes there and the surplus left on the larger side (positive = buys)
+struct AuctionCross {
+    double price;
+    long long volume;
+    long long imbalance;
+};
+
+// The order between two candidate auction prices: more volume, then a smaller
+// imbalance, then closer to the reference price. Returns true if a beats b.
+inline bool betterCross(const AuctionCross& a, const AuctionCross& b, double referencePrice) {
+    if (a.volume != b.volume) return a.volume > b.volume;
+    if (std::llabs(a.imbalance) != std::llabs(b.imbalance)) return std::llabs(a.imbalance) < std::llabs(b.imbalance);
+    long long reference = std::llround(referencePrice * 100.0); // In cents, so equal distances compare equal
+    return std::llabs(std::llround(a.price * 100.0) - reference) < std::llabs(std::llround(b.price * 100.0) - reference);
+}
+
+// Cumulative depth curves for an auction book, kept up to date order by order. With
+// B(p) the buy quantity willing to pay p or more and S(p) the sell quantity willing to
+// take p or less, B - S only falls as p rises, so the best cross is next to where it
+// changes sign: below the last limit price with B >= S every price executes less or
+// leaves a bigger surplus, and likewise above the first one with B < S. Those two can
+// sit on plateaus of prices with identical B and S, where the reference price decides.
+// Quantities live in two Fenwick trees over price ticks, so an arrival or cancel is
+// O(log n) and finding the cross is a binary search of O(log^2 n), with no full uncross.
+//
+// The trees cover a dense tick range that grows as prices arrive. A book whose prices
+// span more than maxSpan ticks is left to the caller's full recompute (dense() false).
+class AuctionDepth {
+    static constexpr long long maxSpan = 1 << 20;  // $10,486 in cents; 16 MiB of trees
+
+    long long baseTick = 0;          // Tick at tree index 1
+    std::vector<long long> buyTree;  // Fenwick trees of limit quantity per tick
+    std::vector<long long> sellTree;
+    std::map<long long, int> levels; // Ticks with any limit order resting, and how many
+    long long limitBuys = 0;
+    long long marketBuys = 0;
+    long long marketSells = 0;
+    bool isDense = true;
+
+public:
+    void clear() { *this = AuctionDepth(); }
+
+    // Adds (sign 1) or removes (sign -1) an order's quantity
+    void update(char side, bool isMarketOrder, double limitPrice, long long quantity, int sign) {
+        quantity *= sign;
+        if (isMarketOrder) {
+            (side == 'B' ? marketBuys : marketSells) += quantity;
+            return;
+        }
+        long long tick = std::llround(limitPrice * 100.0);
+        auto level = levels.emplace(tick, 0).first;
+        level->second += sign;
+        if (level->second == 0) levels.erase(level);
+        if (side == 'B') limitBuys += quantity;
+        if (!isDense) return;
+        if (!cover(tick)) {
+            isDense = false;
+            return;
+        }
+        add(side == 'B' ? buyTree : sellTree, tick, quantity);
+    }
+
+    bool dense() const { return isDense; }
+
+    AuctionCross cross(double referencePrice) const {
+        AuctionCross best{referencePrice, std::min(marketBuys, marketSells), marketBuys - marketSells};
+        if (levels.empty()) return best;
+        long long low = levels.begin()->first, high = levels.rbegin()->first;
+
+        // Last tick where buys still meet or exceed sells
+        long long lastCovered = low - 1;
+        if (surplus(low) >= 0) {
+            long long lo = low, hi = high;
+            while (lo < hi) {
+                long long mid = lo + (hi - lo + 1) / 2;
+                if (surplus(mid) >= 0) lo = mid;
+                else hi = mid - 1;
+            }
+            lastCovered = lo;
+        }
+        bool found = false;
+        auto above = levels.upper_bound(lastCovered);
+        if (above != levels.begin()) {
+            best = bestOnPlateau(std::prev(above)->first, referencePrice);
+            found = true;
+        }
+        if (above != levels.end()) {
+            AuctionCross candidate = bestOnPlateau(above->first, referencePrice);
+            if (!found || betterCross(candidate, best, referencePrice)) best = candidate;
+        }
+        return best;
+    }
+
+private:
+    static constexpr long long farBelow = -(1LL << 62);
+    static constexpr long long farAbove = 1LL << 62;
+
+    // Among the limit prices with the same B and S as `tick`, the one closest to the
+    // reference price (the lower one on a tie)
+    AuctionCross bestOnPlateau(long long tick, double referencePrice) const {
+        long long sellsBefore = prefix(sellTree, tick), buysBefore = prefix(buyTree, tick - 1);
+        // S is flat from the last tick with sells up to the next one, B from just after
+        // the last tick with buys up to the next one
+        long long low = std::max(firstReaching(sellTree, sellsBefore), firstReaching(buyTree, buysBefore) + 1);
+        long long high = std::min(firstReaching(sellTree, sellsBefore + 1) - 1, firstReaching(buyTree, buysBefore + 1));
+        long long referenceTick = std::llround(referencePrice * 100.0);
+        auto next = levels.lower_bound(std::max(low, std::min(high, referenceTick)));
+        bool hasNext = next != levels.end() && next->first <= high;
+        bool hasPrevious = next != levels.begin() && std::prev(next)->first >= low;
+        long long chosen = tick;
+        if (hasNext && hasPrevious) {
+            long long previous = std::prev(next)->first;
+            chosen = referenceTick - previous <= next->first - referenceTick ? previous : next->first;
+        } else if (hasNext) {
+            chosen = next->first;
+        } else if (hasPrevious) {
+            chosen = std::prev(next)->first;
+        }
+        return crossAt(chosen);
+    }
+
+    // Smallest tick whose prefix sum reaches `value` (farBelow if every tick does,
+    // farAbove if none does); quantities are never negative, so the sums only grow
+    long long firstReaching(const std::vector<long long>& tree, long long value) const {
+        if (value <= 0) return farBelow;
+        if (tree.empty()) return farAbove;
+        size_t index = 0;
+        size_t step = 1;
+        while (step * 2 < tree.size()) step *= 2;
+        for (; step > 0; step /= 2) {
+            if (index + step < tree.size() && tree[index + step] < value) {
+                index += step;
+                value -= tree[index];
+            }
+        }
+        return index + 1 < tree.size() ? baseTick + static_cast<long long>(index) : farAbove;
+    }
+
+    AuctionCross crossAt(long long tick) const {
+        long long buys = buysFrom(tick), sells = sellsTo(tick);
+        return AuctionCross{tick / 100.0, std::min(buys, sells), buys - sells};
+    }
+
+    long long buysFrom(long long tick) const { return marketBuys + limitBuys - prefix(buyTree, tick - 1); }
+    long long sellsTo(long long tick) const { return marketSells + prefix(sellTree, tick); }
+    long long surplus(long long tick) const { return buysFrom(tick) - sellsTo(tick); }
+
+    // Sum of the quantities at ticks up to and including `tick`
+    long long prefix(const std::vector<long long>& tree, long long tick) const {
+        if (tree.empty()) return 0;
+        long long index = std::min<long long>(tick - baseTick + 1, static_cast<long long>(tree.size()) - 1);
+        long long sum = 0;
+        for (; index > 0; index -= index & -index) sum += tree[index];
+        return sum;
+    }
+
+    void add(std::vector<long long>& tree, long long tick, long long quantity) {
+        for (size_t index = tick - baseTick + 1; index < tree.size(); index += index & -index) tree[index] += quantity;
+    }
+
+    // Grows the trees to take `tick`; false if the span would exceed maxSpan
+    bool cover(long long tick) {
+        long long size = buyTree.empty() ? 0 : static_cast<long long>(buyTree.size()) - 1;
+        if (size > 0 && tick >= baseTick && tick < baseTick + size) return true;
+        long long low = size > 0 ? std::min(baseTick, tick) : tick;
+        long long high = size > 0 ? std::max(baseTick + size - 1, tick) : tick;
+        if (high - low + 1 > maxSpan) return false;
+        long long newSize = std::max<long long>(size, 1024);
+        while (newSize < 2 * (high - low + 1)) newSize *= 2;
+        newSize = std::min(newSize, maxSpan);
+        // Leave room on both sides so a drifting book rarely needs another rebuild
+        long long newBase = low - (newSize - (high - low + 1)) / 2;
+        rebuild(buyTree, newBase, newSize);
+        rebuild(sellTree, newBase, newSize);
+        baseTick = newBase;
+        return true;
+    }
+
+    void rebuild(std::vector<long long>& tree, long long newBase, long long newSize) const {
+        std::vector<long long> rebuilt(newSize + 1, 0);
+        long long size = tree.empty() ? 0 : static_cast<long long>(tree.size()) - 1;
+        for (long long index = 1; index <= size; ++index) {
+            long long value = prefix(tree, baseTick + index - 1) - prefix(tree, baseTick + index - 2);
+            if (value != 0) rebuilt[baseTick + index - 1 - newBase + 1] += value;
+        }
+        // Linear Fenwick build from the point values
+        for (long long index = 1; index <= newSize; ++index) {
+            long long parent = index + (index & -index);
+            if (parent <= newSize) rebuilt[parent] += rebuilt[index];
+        }
+        tree.swap(rebuilt);
+    }
+};
+
+// Decides when to publish indicative auction updates: at most once per `interval` of
+// simulated time, and only if the cross has changed since the last one sent. Callers
+// check due() first so the cross is not even looked up while the throttle is closed.
+class IndicativeThrottle {
+    int interval;
+    int lastSent = 0;
+    bool sentAny = false;
+    AuctionCross last{0.0, 0, 0};
+
+public:
+    explicit IndicativeThrottle(int minInterval) : interval(minInterval) {}
+
+    bool due(int now) const { return !sentAny || now - lastSent >= interval; }
+
+    // Records the cross as sent and returns true if it differs from the last one
+    bool offer(const AuctionCross& cross, int now) {
+        if (sentAny && cross.price == last.price && cross.volume == last.volume && cross.imbalance == last.imbalance) {
+            return false;
+        }
+        sentAny = true;
+        lastSent = now;
+        last = cross;
+        return true;
+    }
+};
+
+#endif
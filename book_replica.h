@@ -0,0 +1,241 @@
+#ifndef BOOK_REPLICA_H
+#define BOOK_REPLICA_H
+
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "orderbook.h"
+#include "market_data.h"
+
+// Consumer-side copy of the engine's book, maintained from the market-data feed
+// (market_data.h). Read-only consumers can scale out on replicas without touching the
+// matcher; the engine's Checksum messages let every replica prove it is in sync.
+
+class BookReplica {
+    struct RestingOrder {
+        char side;
+        bool isMarketOrder;
+        long long priceTicks;
+        int quantity;
+    };
+
+    std::unordered_map<std::string, RestingOrder> orders;
+    std::map<long long, long long, std::greater<long long>> bidLevels; // Limit depth, best first
+    std::map<long long, long long> askLevels;
+    uint64_t sum = 0;          // Same construction as OrderBook::checksum()
+    uint64_t lastSeq = 0;      // Last message applied
+    long long lastTradeTicks = 0;
+    long long checksOk = 0;
+    long long checksFailed = 0;
+    long long indicatives = 0;
+    AuctionCross indicative{0.0, 0, 0};  // Latest indicative auction cross
+    bool ended = false;
+
+public:
+    // Replaces the replica with a snapshot (as returned by requestRetransmission with
+    // fromSeq 0). Returns false if the snapshot does not match its own checksum.
+    bool loadSnapshot(const std::vector<FeedMessage>& snapshot) {
+        orders.clear();
+        bidLevels.clear();
+        askLevels.clear();
+        sum = 0;
+        if (snapshot.empty()) return false;
+        for (const auto& message : snapshot) {
+            if (message.type == FeedOrderUpdate) setOrder(message);
+        }
+        lastSeq = snapshot.front().seq;
+        return snapshot.front().type == FeedChecksum && snapshot.front().checksum == sum;
+    }
+
+    uint64_t nextExpected() const { return lastSeq + 1; }
+
+    // Applies the next incremental. Messages already covered are ignored; a message past
+    // nextExpected() is refused (returns false) so the caller can fill the gap first.
+    bool apply(const FeedMessage& message) {
+        if (message.seq <= lastSeq) return true;
+        if (message.seq != lastSeq + 1) return false;
+        lastSeq = message.seq;
+        switch (message.type) {
+        case FeedOrderUpdate:
+            setOrder(message);
+            break;
+        case FeedTrade:
+            lastTradeTicks = message.priceTicks;
+            break;
+        case FeedChecksum:
+            (message.checksum == sum ? checksOk : checksFailed) += 1;
+            break;
+        case FeedEndOfSession:
+            ended = true;
+            break;
+        case FeedIndicative:
+            indicative = AuctionCross{message.priceTicks / 100.0, message.volume, message.imbalance};
+            ++indicatives;
+            break;
+        }
+        return true;
+    }
+
+    uint64_t checksum() const { return sum; }
+    long long checksPassed() const { return checksOk; }
+    long long checksMismatched() const { return checksFailed; }
+    bool sessionEnded() const { return ended; }
+    long long indicativeUpdates() const { return indicatives; }
+    const AuctionCross& lastIndicative() const { return indicative; }
+    size_t orderCount() const { return orders.size(); }
+
+    // Best limit prices and sizes; false if that side is empty
+    bool bestBid(double& price, long long& size) const { return best(bidLevels, price, size); }
+    bool bestAsk(double& price, long long& size) const { return best(askLevels, price, size); }
+    double lastTradePrice() const { return lastTradeTicks / 100.0; }
+
+private:
+    template <typename Levels>
+    static bool best(const Levels& levels, double& price, long long& size) {
+        if (levels.empty()) return false;
+        price = levels.begin()->first / 100.0;
+        size = levels.begin()->second;
+        return true;
+    }
+
+    void adjustLevel(const RestingOrder& order, long long delta) {
+        if (order.isMarketOrder) return;
+        if (order.side == 'B') {
+            adjust(bidLevels, order.priceTicks, delta);
+        } else {
+            adjust(askLevels, order.priceTicks, delta);
+        }
+    }
+
+    template <typename Levels>
+    static void adjust(Levels& levels, long long ticks, long long delta) {
+        long long& size = levels[ticks];
+        size += delta;
+        if (size <= 0) levels.erase(ticks);
+    }
+
+    static uint64_t hashOf(const std::string& id, const RestingOrder& order) {
+        return orderChecksum(id, order.side, order.priceTicks / 100.0, order.quantity);
+    }
+
+    // Sets an order's remaining quantity (0 removes it)
+    void setOrder(const FeedMessage& message) {
+        auto it = orders.find(message.id);
+        if (it != orders.end()) {
+            sum -= hashOf(it->first, it->second);
+            adjustLevel(it->second, -it->second.quantity);
+            if (message.quantity <= 0) {
+                orders.erase(it);
+                return;
+            }
+            it->second.quantity = message.quantity;
+        } else {
+            if (message.quantity <= 0) return;
+            RestingOrder order{message.side, message.isMarketOrder, message.priceTicks, message.quantity};
+            it = orders.emplace(message.id, order).first;
+        }
+        sum += hashOf(it->first, it->second);
+        adjustLevel(it->second, it->second.quantity);
+    }
+};
+
+// Keeps a BookReplica in step with a live feed. A subscriber that joins mid-session (its
+// first datagram is not sequence 1) loads the publisher's latest snapshot and replays
+// incrementals from the snapshot's sequence number: datagrams that arrive meanwhile wait
+// in the socket buffer, older messages are skipped and any hole between the snapshot and
+// the feed is filled over TCP. If a hole cannot be filled the subscriber resynchronises
+// from a fresh snapshot.
+class FeedSubscriber {
+    FeedConfig config;
+    BookReplica& replica;
+    int fd = -1;
+
+public:
+    long long gaps = 0;
+    long long recovered = 0;
+    long long snapshots = 0;
+
+    FeedSubscriber(const FeedConfig& feedConfig, BookReplica& bookReplica) : config(feedConfig), replica(bookReplica) {}
+
+    ~FeedSubscriber() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    FeedSubscriber(const FeedSubscriber&) = delete;
+    FeedSubscriber& operator=(const FeedSubscriber&) = delete;
+
+    bool open() {
+        fd = openFeedReceiver(config.group, config.port);
+        if (fd < 0) return false;
+        timeval timeout{1, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return true;
+    }
+
+    // Follows the feed until the end of the session (or until the publisher goes away);
+    // onMessage, if given, sees every message after it has been applied
+    bool run(const std::function<void(const FeedMessage&)>& onMessage = nullptr) {
+        std::vector<char> buffer(65536);
+        std::vector<FeedMessage> messages;
+        bool started = false;
+        while (!replica.sessionEnded()) {
+            ssize_t got = ::recv(fd, buffer.data(), buffer.size(), 0);
+            if (got < 0) {
+                if (!started) continue;  // Session has not started yet
+                // Quiet mid-session: the tail (including end of session) may have been lost
+                if (!fillFrom(replica.nextExpected(), 1u << 20, onMessage)) return false;
+                continue;
+            }
+            if (!decodePacket(buffer.data(), static_cast<size_t>(got), messages) || messages.empty()) continue;
+            if (!started) {
+                started = true;
+                if (messages.front().seq > 1 && !resync()) return false;
+            }
+            if (messages.front().seq > replica.nextExpected()) {
+                ++gaps;
+                uint64_t upTo = messages.front().seq;
+                if (!fillFrom(replica.nextExpected(), static_cast<uint32_t>(upTo - replica.nextExpected()), onMessage) ||
+                    replica.nextExpected() < upTo) {
+                    if (!resync()) return false;
+                }
+            }
+            for (const auto& message : messages) {
+                if (message.seq == replica.nextExpected() && replica.apply(message) && onMessage) onMessage(message);
+            }
+        }
+        return true;
+    }
+
+private:
+    bool fillFrom(uint64_t fromSeq, uint32_t count, const std::function<void(const FeedMessage&)>& onMessage) {
+        std::vector<FeedMessage> missing;
+        if (!requestRetransmission(config.retransmitPort, fromSeq, count, missing)) return false;
+        for (const auto& message : missing) {
+            if (!replica.apply(message)) break;  // The publisher no longer holds part of it
+            ++recovered;
+            if (onMessage) onMessage(message);
+        }
+        return true;
+    }
+
+    // Reloads the replica from the publisher's latest snapshot
+    bool resync() {
+        std::vector<FeedMessage> snapshot;
+        for (int attempt = 0; attempt < 50; ++attempt) {
+            if (requestRetransmission(config.retransmitPort, 0, 0, snapshot) && replica.loadSnapshot(snapshot)) {
+                ++snapshots;
+                return true;
+            }
+            ::usleep(100000);
+        }
+        return false;
+    }
+};
+
+#endif
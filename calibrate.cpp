@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "flow_params.h"
+
+// Estimates order-flow statistics from an existing input file and writes them as a
+// parameter file for the synthetic generators.
+//   ./calibrate [--max-lifetime N] <input_file> <params_file> [threads]
+//
+// The file is read once, in large blocks. Each block is cut at line boundaries into ranges
+// of a fixed size; threads take ranges in turn, parse them into private statistics, and
+// those are merged in file order. Each range warms its reference price up from the lines
+// just before it, so the cuts decide the offsets; they do not depend on the thread count,
+// and neither does the parameter file. Cancels are lines of the form "<orderID> C".
+//
+// Cancel lifetimes are only measured up to --max-lifetime events (default 2^20). An order
+// with no cancel by then is dropped and counted as censored, so memory is bounded by the
+// orders added within that window rather than by every order in the file (most are
+// filled or never cancelled). A cancel that comes later no longer finds its order.
+
+namespace {
+
+const size_t blockSize = 64 << 20;
+const size_t rangeSize = 4 << 20;  // Fixed, whatever the thread count: see above
+const long long defaultMaxLifetime = 1 << 20;
+
+// Statistics gathered from one range of lines
+struct RangeStats {
+    long long buys = 0, sells = 0, cancels = 0, markets = 0;
+    std::map<long long, long long> sizes, offsets, lifetimes;
+    std::unordered_map<std::string, long long> addTimes;
+    // Cancels whose order was not added in this range; resolved against earlier ranges
+    std::vector<std::pair<std::string, long long>> openCancels;
+    long long censored = 0;  // Orders with no cancel within the lifetime cap
+
+    // A cancel at `timestamp` of an order in addTimes: its lifetime, or censored if the
+    // cap had already passed
+    void cancelAdded(std::unordered_map<std::string, long long>::iterator added, long long timestamp,
+                     long long maxLifetime) {
+        long long lifetime = timestamp - added->second;
+        if (lifetime <= maxLifetime) {
+            ++lifetimes[lifetime];
+        } else {
+            ++censored;
+        }
+        addTimes.erase(added);
+    }
+};
+
+// Orders still waiting for a cancel across ranges, oldest first, so those past the cap can
+// be dropped. `order` may hold entries already cancelled or re-added; they are skipped.
+struct OpenOrders {
+    std::unordered_map<std::string, long long>& addTimes;
+    std::deque<std::pair<long long, std::string>> order;
+
+    // Drops the orders that have gone more than maxLifetime events without a cancel by
+    // `timestamp` (the last one seen); returns how many
+    long long expire(long long timestamp, long long maxLifetime) {
+        long long dropped = 0;
+        while (!order.empty() && timestamp - order.front().first > maxLifetime) {
+            auto it = addTimes.find(order.front().second);
+            if (it != addTimes.end() && it->second == order.front().first) {
+                addTimes.erase(it);
+                ++dropped;
+            }
+            order.pop_front();
+        }
+        return dropped;
+    }
+};
+
+// One order line split into fields; returns false for blank or malformed lines
+struct ParsedLine {
+    std::string id;
+    char type = 0;
+    long long quantity = 0;
+    bool hasPrice = false;
+    double price = 0.0;
+};
+
+bool parseLine(const char* begin, const char* end, ParsedLine& parsed) {
+    const char* fields[4];
+    const char* fieldEnds[4];
+    int count = 0;
+    const char* p = begin;
+    while (p < end && count < 4) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+        if (p == end) break;
+        fields[count] = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r') ++p;
+        fieldEnds[count++] = p;
+    }
+    if (count < 2 || fieldEnds[1] - fields[1] != 1) return false;
+    parsed.id.assign(fields[0], fieldEnds[0]);
+    parsed.type = *fields[1];
+    if (parsed.type == 'C') return true;
+    if ((parsed.type != 'B' && parsed.type != 'S') || count < 3) return false;
+    parsed.quantity = std::strtoll(std::string(fields[2], fieldEnds[2]).c_str(), nullptr, 10);
+    parsed.hasPrice = count == 4;
+    if (parsed.hasPrice) parsed.price = std::strtod(std::string(fields[3], fieldEnds[3]).c_str(), nullptr);
+    return true;
+}
+
+// Parses [begin, end) whose first line has timestamp firstTimestamp. The reference price
+// is warmed up from the lines in [warmup, begin) first.
+void processRange(const char* warmup, const char* begin, const char* end, long long firstTimestamp,
+                  long long maxLifetime, RangeStats& stats) {
+    ReferencePrice reference;
+    ParsedLine parsed;
+    for (const char* line = warmup; line < begin;) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', begin - line));
+        if (!lineEnd) lineEnd = begin;
+        if (parseLine(line, lineEnd, parsed) && parsed.type != 'C' && parsed.hasPrice) reference.update(parsed.price);
+        line = lineEnd + 1;
+    }
+
+    long long timestamp = firstTimestamp;
+    for (const char* line = begin; line < end; ++timestamp) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!lineEnd) lineEnd = end;
+        if (parseLine(line, lineEnd, parsed)) {
+            if (parsed.type == 'C') {
+                ++stats.cancels;
+                auto added = stats.addTimes.find(parsed.id);
+                if (added != stats.addTimes.end()) {
+                    stats.cancelAdded(added, timestamp, maxLifetime);
+                } else {
+                    stats.openCancels.emplace_back(parsed.id, timestamp);
+                }
+            } else {
+                (parsed.type == 'B' ? stats.buys : stats.sells) += 1;
+                ++stats.sizes[parsed.quantity];
+                stats.addTimes[parsed.id] = timestamp;
+                if (!parsed.hasPrice) {
+                    ++stats.markets;
+                } else {
+                    if (reference.seeded) {
+                        ++stats.offsets[priceOffsetTicks(parsed.type, parsed.price, reference.value)];
+                    }
+                    reference.update(parsed.price);
+                }
+            }
+        }
+        line = lineEnd + 1;
+    }
+}
+
+// Start of the line `lines` lines before position (bounded by begin)
+const char* backUpLines(const char* begin, const char* position, int lines) {
+    const char* p = position;
+    while (p > begin && lines > 0) {
+        --p;
+        while (p > begin && p[-1] != '\n') --p;
+        --lines;
+    }
+    return p;
+}
+
+void mergeHistogram(std::map<long long, long long>& into, const std::map<long long, long long>& from) {
+    for (const auto& bucket : from) into[bucket.first] += bucket.second;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    long long maxLifetime = defaultMaxLifetime;
+    if (argc > 2 && std::string(argv[1]) == "--max-lifetime") {
+        maxLifetime = std::atoll(argv[2]);
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc < 3 || argc > 4 || maxLifetime <= 0) {
+        std::cerr << "Usage: ./calibrate [--max-lifetime N] <input_file> <params_file> [threads]\n";
+        return 1;
+    }
+    std::ifstream inputFile(argv[1], std::ios::binary);
+    if (!inputFile) {
+        std::cerr << "Error: Could not open file " << argv[1] << "\n";
+        return 1;
+    }
+    unsigned threadCount = argc > 3 ? std::atoi(argv[3]) : std::thread::hardware_concurrency();
+    if (threadCount == 0) threadCount = 1;
+
+    FlowParams params;
+    std::string firstLine;
+    std::getline(inputFile, firstLine);
+    params.openPrice = std::strtod(firstLine.c_str(), nullptr);
+
+    RangeStats total;
+    OpenOrders open{total.addTimes, {}};
+    long long timestamp = 1;  // Same numbering as the simulator: first order line is 1
+    std::string context;      // Tail of the previous block, only used to warm up references
+    std::string carry;        // Incomplete last line of the previous block
+    std::vector<char> block(blockSize);
+
+    while (true) {
+        inputFile.read(block.data(), block.size());
+        size_t got = static_cast<size_t>(inputFile.gcount());
+        bool atEnd = got < block.size();
+
+        std::string buffer = context + carry;
+        size_t workStart = context.size();
+        buffer.append(block.data(), got);
+        size_t workEnd = buffer.size();
+        if (!atEnd) {
+            size_t lastNewline = buffer.rfind('\n');
+            workEnd = (lastNewline == std::string::npos || lastNewline < workStart) ? workStart : lastNewline + 1;
+        }
+
+        // Cut the work region into ranges at line starts and number their lines
+        const char* base = buffer.data();
+        std::vector<const char*> cuts{base + workStart};
+        for (size_t offset = rangeSize; offset < workEnd - workStart; offset += rangeSize) {
+            const char* target = base + workStart + offset;
+            if (target <= cuts.back()) continue;
+            const char* newline = static_cast<const char*>(std::memchr(target - 1, '\n', base + workEnd - (target - 1)));
+            if (!newline || newline + 1 >= base + workEnd) break;
+            if (newline + 1 > cuts.back()) cuts.push_back(newline + 1);
+        }
+        cuts.push_back(base + workEnd);
+
+        size_t ranges = cuts.size() - 1;
+        std::vector<long long> firstTimestamps(ranges);
+        for (size_t r = 0; r < ranges; ++r) {
+            firstTimestamps[r] = timestamp;
+            long long lines = std::count(cuts[r], cuts[r + 1], '\n');
+            if (cuts[r + 1] > cuts[r] && cuts[r + 1][-1] != '\n') ++lines;  // Unterminated final line
+            timestamp += lines;
+        }
+
+        std::vector<RangeStats> stats(ranges);
+        std::atomic<size_t> nextRange{0};
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < std::min<size_t>(threadCount, ranges); ++t) {
+            workers.emplace_back([&] {
+                for (size_t r = nextRange++; r < ranges; r = nextRange++) {
+                    const char* warmup = backUpLines(base, cuts[r], ReferencePrice::warmupLines);
+                    processRange(warmup, cuts[r], cuts[r + 1], firstTimestamps[r], maxLifetime, stats[r]);
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+
+        // Merge in file order so cancels can find orders added by earlier ranges
+        for (auto& range : stats) {
+            total.buys += range.buys;
+            total.sells += range.sells;
+            total.cancels += range.cancels;
+            total.markets += range.markets;
+            total.censored += range.censored;
+            mergeHistogram(total.sizes, range.sizes);
+            mergeHistogram(total.offsets, range.offsets);
+            mergeHistogram(total.lifetimes, range.lifetimes);
+            for (const auto& cancel : range.openCancels) {
+                auto added = total.addTimes.find(cancel.first);
+                if (added != total.addTimes.end()) total.cancelAdded(added, cancel.second, maxLifetime);
+            }
+            std::vector<std::pair<long long, std::string>> leftovers;
+            leftovers.reserve(range.addTimes.size());
+            for (auto& added : range.addTimes) {
+                total.addTimes[added.first] = added.second;
+                leftovers.emplace_back(added.second, added.first);
+            }
+            std::sort(leftovers.begin(), leftovers.end());
+            for (auto& added : leftovers) open.order.push_back(std::move(added));
+        }
+        // timestamp is now one past the last line of the block
+        total.censored += open.expire(timestamp - 1, maxLifetime);
+
+        if (atEnd) break;
+        const char* contextStart = backUpLines(base + workStart, base + workEnd, ReferencePrice::warmupLines);
+        context.assign(contextStart, base + workEnd);
+        carry.assign(base + workEnd, buffer.size() - workEnd);
+    }
+
+    params.events = timestamp - 1;
+    if (params.events > 0) {
+        params.buyShare = static_cast<double>(total.buys) / params.events;
+        params.sellShare = static_cast<double>(total.sells) / params.events;
+        params.cancelShare = static_cast<double>(total.cancels) / params.events;
+    }
+    if (total.buys + total.sells > 0) {
+        params.marketShare = static_cast<double>(total.markets) / (total.buys + total.sells);
+    }
+    if (!total.sizes.empty()) params.sizeQuantiles = quantilesFromHistogram(total.sizes);
+    if (!total.offsets.empty()) params.offsetQuantiles = quantilesFromHistogram(total.offsets);
+    if (!total.lifetimes.empty()) params.cancelLifetimeQuantiles = quantilesFromHistogram(total.lifetimes);
+
+    if (!params.save(argv[2], argv[1])) {
+        std::cerr << "Error: Could not write " << argv[2] << "\n";
+        return 1;
+    }
+    std::cout << "Calibrated " << params.events << " events from " << argv[1] << " using "
+              << threadCount << " threads\n";
+    if (total.censored > 0) {
+        std::cout << total.censored << " orders went " << maxLifetime
+                  << " events without a cancel and were left out of the lifetimes\n";
+    }
+    return 0;
+}
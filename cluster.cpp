@@ -0,0 +1,272 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "orderbook.h"
+#include "shard_link.h"
+#include "symbol_directory.h"
+#include "symbol_scheduler.h"
+#include "tsc_clock.h"
+
+// Runs a multi-symbol input file (format in symbol_scheduler.h) on shard processes that
+// each own a slice of the symbols, with this process as the coordinator (shard_link.h).
+//   ./cluster [--batch N] [--window N] <input_file> <shards>            (forks local shards)
+//   ./cluster [--batch N] [--window N] <input_file> <host:port> ...     (shards already running)
+//   ./cluster --shard <port>                                            (run one shard)
+// Symbols are dealt to shards round-robin. --batch is orders per frame (default 256) and
+// --window the most un-acked orders per link (default 8192). The report has the same
+// per-symbol lines as ./exchange, so the two can be compared directly. OPEN is supported;
+// BASKET lines are not.
+namespace {
+
+struct SymbolStats {
+    std::string symbol;
+    double initialPrice = 0.0;
+    size_t shard = 0;
+    uint32_t index = 0;  // Book number within its shard
+    long long trades = 0;
+    long long volume = 0;
+    uint64_t fillHash = 1469598103934665603ULL;
+    long long processed = 0;
+    double last = 0.0;
+    uint64_t openOrders = 0;
+    uint64_t checksum = 0;
+};
+
+int runShard(int listenSocket) {
+    ShardServer server;
+    bool ok = server.serve(listenSocket);
+    ::close(listenSocket);
+    return ok ? 0 : 1;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t batch = 256;
+    size_t window = 8192;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--shard" && i + 1 < argc) {
+            int listenSocket = listenOn(static_cast<uint16_t>(std::atoi(argv[++i])), false);
+            if (listenSocket < 0) {
+                std::cerr << "Error: Could not listen on port " << argv[i] << "\n";
+                return 1;
+            }
+            return runShard(listenSocket);
+        }
+        if (arg == "--batch" && i + 1 < argc) batch = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--window" && i + 1 < argc) window = std::max(1, std::atoi(argv[++i]));
+        else positional.push_back(arg);
+    }
+    if (positional.size() < 2) {
+        std::cerr << "Usage: ./cluster [--batch N] [--window N] <input_file> <shards | host:port ...>\n"
+                     "       ./cluster --shard <port>\n";
+        return 1;
+    }
+    std::ifstream inputFile(positional[0]);
+    if (!inputFile) {
+        std::cerr << "Error: Could not open file " << positional[0] << "\n";
+        return 1;
+    }
+
+    std::vector<SymbolStats> symbols;
+    std::vector<std::string> names;
+    int symbolCount = 0;
+    inputFile >> symbolCount;
+    for (int i = 0; i < symbolCount; ++i) {
+        SymbolStats entry;
+        inputFile >> entry.symbol >> entry.initialPrice;
+        names.push_back(entry.symbol);
+        symbols.push_back(entry);
+    }
+    inputFile.ignore();
+    SymbolDirectory directory(names);
+    if (!inputFile || symbols.empty()) {
+        std::cerr << "Error: Invalid symbol list in " << positional[0] << "\n";
+        return 1;
+    }
+
+    std::vector<std::pair<size_t, Order>> orders;
+    std::string line, symbol, orderText;
+    int timestamp = 0;
+    size_t openAt = 0;
+    bool auction = false;
+    while (std::getline(inputFile, line)) {
+        ++timestamp;
+        if (line == "OPEN") {
+            openAt = orders.size();
+            auction = true;
+            continue;
+        }
+        if (line.compare(0, 7, "BASKET ") == 0) {
+            std::cerr << "Error: Baskets are not supported by cluster (line " << timestamp << ")\n";
+            return 1;
+        }
+        if (!splitSymbolLine(line, symbol, orderText)) continue;
+        size_t index = directory.find(symbol);
+        if (index == SymbolDirectory::npos) {
+            std::cerr << "Error: Unknown symbol " << symbol << " on line " << timestamp << "\n";
+            return 1;
+        }
+        orders.emplace_back(index, parseOrder(orderText, timestamp));
+    }
+
+    // Shards: a count forks that many on loopback, anything else is a list of endpoints
+    std::vector<int> sockets;
+    std::vector<pid_t> children;
+    if (positional.size() == 2 && positional[1].find(':') == std::string::npos) {
+        int count = std::max(1, std::atoi(positional[1].c_str()));
+        for (int i = 0; i < count; ++i) {
+            int listenSocket = listenOn(0, true);
+            if (listenSocket < 0) {
+                std::cerr << "Error: Could not open a shard port\n";
+                return 1;
+            }
+            std::string endpoint = "127.0.0.1:" + std::to_string(boundPort(listenSocket));
+            std::cout.flush();
+            pid_t child = ::fork();
+            if (child == 0) {
+                for (int fd : sockets) ::close(fd);
+                ::_exit(runShard(listenSocket));
+            }
+            ::close(listenSocket);
+            children.push_back(child);
+            sockets.push_back(connectTo(endpoint));  // Already listening, so this cannot race
+        }
+    } else {
+        for (size_t i = 1; i < positional.size(); ++i) sockets.push_back(connectTo(positional[i]));
+    }
+    for (size_t i = 0; i < sockets.size(); ++i) {
+        if (sockets[i] < 0) {
+            std::cerr << "Error: Could not connect to shard " << i << "\n";
+            return 1;
+        }
+    }
+
+    // Frames coming back from shard s update that shard's symbols
+    std::vector<std::vector<size_t>> shardSymbols(sockets.size());
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        symbols[i].shard = i % sockets.size();
+        symbols[i].index = static_cast<uint32_t>(shardSymbols[symbols[i].shard].size());
+        shardSymbols[symbols[i].shard].push_back(i);
+    }
+    long long openVolume = 0;
+    std::vector<bool> opened(sockets.size(), false), finished(sockets.size(), false);
+    std::vector<std::unique_ptr<ShardLink>> links;
+    std::vector<std::function<bool(uint8_t, ByteReader&)>> handlers;
+    for (size_t s = 0; s < sockets.size(); ++s) {
+        links.push_back(std::make_unique<ShardLink>(sockets[s], batch, window));
+        handlers.push_back([&, s](uint8_t type, ByteReader& reader) {
+            const std::vector<size_t>& owned = shardSymbols[s];
+            uint32_t count = 0;
+            if (type == LinkFills) {
+                if (!reader.read(count)) return false;
+                for (uint32_t i = 0; i < count; ++i) {
+                    uint32_t index;
+                    Fill fill;
+                    if (!reader.read(index) || index >= owned.size() || !reader.readString(fill.buyId) ||
+                        !reader.readString(fill.sellId) || !reader.read(fill.quantity) || !reader.read(fill.price)) {
+                        return false;
+                    }
+                    SymbolStats& entry = symbols[owned[index]];
+                    ++entry.trades;
+                    entry.volume += fill.quantity;
+                    entry.fillHash = (entry.fillHash ^ orderChecksum(fill.buyId + "/" + fill.sellId, 'F', fill.price,
+                                                                     fill.quantity)) * 1099511628211ULL;
+                }
+            } else if (type == LinkOpened) {
+                int64_t volume = 0;
+                if (!reader.read(volume)) return false;
+                openVolume += volume;
+                opened[s] = true;
+            } else if (type == LinkResults) {
+                if (!reader.read(count) || count != owned.size()) return false;
+                for (size_t index : owned) {
+                    SymbolStats& entry = symbols[index];
+                    int64_t processed;
+                    if (!reader.read(processed) || !reader.read(entry.last) || !reader.read(entry.openOrders) ||
+                        !reader.read(entry.checksum)) {
+                        return false;
+                    }
+                    entry.processed = processed;
+                }
+                finished[s] = true;
+            }
+            return true;
+        });
+    }
+
+    auto fail = [&](size_t s) {
+        std::cerr << "Error: Lost the link to shard " << s << "\n";
+        for (pid_t child : children) ::kill(child, SIGTERM);
+        return 1;
+    };
+    uint64_t started = TscClock::now();
+    for (size_t s = 0; s < links.size(); ++s) {
+        std::vector<std::pair<std::string, double>> books;
+        for (size_t index : shardSymbols[s]) books.emplace_back(symbols[index].symbol, symbols[index].initialPrice);
+        if (!links[s]->assign(books, auction, handlers[s])) return fail(s);
+    }
+    auto dispatch = [&](size_t from, size_t to) {
+        for (size_t i = from; i < to; ++i) {
+            const SymbolStats& entry = symbols[orders[i].first];
+            if (!links[entry.shard]->submit(entry.index, orders[i].second, handlers[entry.shard])) return entry.shard;
+        }
+        return links.size();
+    };
+    size_t broken = dispatch(0, openAt);
+    if (broken < links.size()) return fail(broken);
+    double openSeconds = 0.0;
+    if (auction) {
+        uint64_t openStarted = TscClock::now();
+        for (size_t s = 0; s < links.size(); ++s) {
+            if (!links[s]->control(LinkOpen, handlers[s])) return fail(s);
+        }
+        for (size_t s = 0; s < links.size(); ++s) {
+            while (!opened[s]) {
+                if (!links[s]->receive(handlers[s])) return fail(s);
+            }
+        }
+        openSeconds = TscClock::seconds(TscClock::nowOrdered() - openStarted);
+    }
+    broken = dispatch(openAt, orders.size());
+    if (broken < links.size()) return fail(broken);
+    for (size_t s = 0; s < links.size(); ++s) {
+        if (!links[s]->control(LinkFinish, handlers[s])) return fail(s);
+    }
+    for (size_t s = 0; s < links.size(); ++s) {
+        while (!finished[s]) {
+            if (!links[s]->receive(handlers[s])) return fail(s);
+        }
+    }
+    double seconds = TscClock::seconds(TscClock::nowOrdered() - started);
+    for (pid_t child : children) ::waitpid(child, nullptr, 0);
+
+    std::cout << "symbol orders trades volume last open_orders checksum fill_hash\n";
+    for (const auto& entry : symbols) {
+        std::cout << entry.symbol << " " << entry.processed << " " << entry.trades << " " << entry.volume << " "
+                  << formatPrice(entry.last) << " " << entry.openOrders << " " << std::hex << entry.checksum << " "
+                  << entry.fillHash << std::dec << "\n";
+    }
+    std::cout << "Processed " << orders.size() << " orders for " << symbols.size() << " symbols on " << links.size()
+              << " shard processes in " << seconds << "s ("
+              << static_cast<long long>(seconds > 0 ? orders.size() / seconds : 0) << " orders/s)\n";
+    if (auction) std::cout << "Opening cross: " << openVolume << " shares in " << openSeconds * 1000 << " ms\n";
+    for (size_t s = 0; s < links.size(); ++s) {
+        std::cout << "Shard " << s << ": " << shardSymbols[s].size() << " symbols, " << links[s]->framesSent
+                  << " frames, " << links[s]->bytesSent / 1024 << " KiB sent, " << links[s]->stalls
+                  << " flow-control stalls\n";
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "orderbook.h"
+#include "symbol_directory.h"
+#include "symbol_scheduler.h"
+#include "tsc_clock.h"
+
+// Runs a multi-symbol input file (format in symbol_scheduler.h) with one book per symbol
+// on a work-stealing pool of threads, then reports every symbol and the load per worker.
+//   ./exchange [--static] [--batch N] [--rebalance N] [--open-fills F] [--fills F] <input_file> [threads]
+// --static turns stealing off (fixed symbol-to-thread sharding) for comparison and
+// --rebalance sets how many orders pass between hot-symbol migrations (0 turns them off).
+// The input is parsed up front; the timing covers dispatching and matching only. Each
+// symbol's fill_hash covers its fills in order, so runs with different threads, modes
+// and migrations can be checked against each other. If the input has an OPEN line the
+// opening auction's results and fills are written to --open-fills (if given) in symbol
+// order, and the continuous-trading fills to --fills (if given), symbol by symbol. Both
+// files are the same byte for byte whatever the threads, mode or migrations. A BASKET whose legs do not all pass validateBasket() is reported and skipped
+// whole; an accepted one goes to the scheduler as a single submitBasket().
+namespace {
+
+struct SymbolStats {
+    long long trades = 0;
+    long long volume = 0;
+    uint64_t fillHash = 1469598103934665603ULL;
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    bool stealing = true;
+    size_t batch = 64;
+    long long rebalance = 50000;
+    std::string openFillsFilename;
+    std::string fillsFilename;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--static") stealing = false;
+        else if (arg == "--batch" && i + 1 < argc) batch = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--rebalance" && i + 1 < argc) rebalance = std::atoll(argv[++i]);
+        else if (arg == "--open-fills" && i + 1 < argc) openFillsFilename = argv[++i];
+        else if (arg == "--fills" && i + 1 < argc) fillsFilename = argv[++i];
+        else positional.push_back(arg);
+    }
+    if (positional.empty() || positional.size() > 2) {
+        std::cerr << "Usage: ./exchange [--static] [--batch N] [--rebalance N] [--open-fills F] [--fills F] "
+                     "<input_file> [threads]\n";
+        return 1;
+    }
+    std::ifstream inputFile(positional[0]);
+    if (!inputFile) {
+        std::cerr << "Error: Could not open file " << positional[0] << "\n";
+        return 1;
+    }
+    unsigned threadCount = positional.size() > 1 ? std::atoi(positional[1].c_str()) : std::thread::hardware_concurrency();
+    if (threadCount == 0) threadCount = 1;
+
+    SymbolScheduler scheduler(threadCount, stealing, batch, rebalance);
+    std::vector<std::string> names;
+    int symbolCount = 0;
+    inputFile >> symbolCount;
+    for (int i = 0; i < symbolCount; ++i) {
+        std::string symbol;
+        double initialPrice;
+        inputFile >> symbol >> initialPrice;
+        scheduler.addSymbol(symbol, initialPrice);
+        names.push_back(symbol);
+    }
+    inputFile.ignore();
+    SymbolDirectory directory(names);  // Symbol -> index into getSymbols()
+    if (!inputFile || directory.empty()) {
+        std::cerr << "Error: Invalid symbol list in " << positional[0] << "\n";
+        return 1;
+    }
+
+    // Fill listeners run on whichever worker holds the symbol, one at a time
+    std::vector<SymbolStats> stats(scheduler.getSymbols().size());
+    for (size_t i = 0; i < stats.size(); ++i) {
+        SymbolStats& entry = stats[i];
+        scheduler.getSymbols()[i]->book.addFillListener([&entry](const Fill& fill) {
+            ++entry.trades;
+            entry.volume += fill.quantity;
+            entry.fillHash = (entry.fillHash ^ orderChecksum(fill.buyId + "/" + fill.sellId, 'F', fill.price,
+                                                             fill.quantity)) * 1099511628211ULL;
+        });
+    }
+
+    std::vector<RoutedOrder> orders;
+    std::vector<std::pair<size_t, size_t>> baskets;  // First leg and leg count, in order
+    long long rejectedBaskets = 0;
+    std::string line, symbol, orderText;
+    int timestamp = 0;
+    size_t openAt = 0;  // Orders before this index are for the opening auction
+    auto route = [&](const std::string& text, RoutedOrder& routed) {
+        if (!splitSymbolLine(text, symbol, orderText)) return false;
+        size_t index = directory.find(symbol);
+        routed = RoutedOrder{index == SymbolDirectory::npos ? nullptr : scheduler.getSymbols()[index].get(),
+                             parseOrder(orderText, timestamp)};
+        return true;
+    };
+    while (std::getline(inputFile, line)) {
+        ++timestamp;
+        if (line == "OPEN") {
+            openAt = orders.size();
+            for (const auto& entry : scheduler.getSymbols()) entry->book.startAuction();
+            continue;
+        }
+        if (line.compare(0, 7, "BASKET ") == 0) {
+            std::istringstream header(line.substr(7));
+            std::string basketId;
+            int legCount = 0;
+            header >> basketId >> legCount;
+            std::vector<RoutedOrder> legs;
+            std::string reason;
+            bool complete = true;
+            for (int i = 0; i < legCount; ++i) {
+                RoutedOrder leg;
+                if (!std::getline(inputFile, line)) {
+                    reason = "input ends before leg " + std::to_string(i + 1);
+                    complete = false;
+                    break;
+                }
+                ++timestamp;
+                if (!route(line, leg)) {
+                    reason = "leg " + std::to_string(i + 1) + " is not an order line";
+                    complete = false;
+                    break;
+                }
+                legs.push_back(leg);
+            }
+            if (complete && validateBasket(legs.data(), legs.size(), reason)) {
+                baskets.emplace_back(orders.size(), legs.size());
+                orders.insert(orders.end(), legs.begin(), legs.end());
+            } else {
+                std::cerr << "Basket " << basketId << " on line " << timestamp << " rejected: " << reason << "\n";
+                ++rejectedBaskets;
+            }
+            continue;
+        }
+        RoutedOrder routed;
+        if (!route(line, routed)) continue;
+        if (!routed.target) {
+            std::cerr << "Error: Unknown symbol " << symbol << " on line " << timestamp << "\n";
+            return 1;
+        }
+        orders.push_back(routed);
+    }
+
+    std::ofstream openFillsFile;
+    if (!openFillsFilename.empty()) openFillsFile.open(openFillsFilename);
+    std::ostream discard(nullptr);
+    std::ostream& openFills = openFillsFile.is_open() ? static_cast<std::ostream&>(openFillsFile) : discard;
+
+    std::ofstream fillsFile;
+    if (!fillsFilename.empty()) fillsFile.open(fillsFilename);
+    if (!fillsFile.is_open()) scheduler.discardOutput();
+    uint64_t started = TscClock::now();
+    scheduler.start();
+    // Single orders one at a time, each basket in one dispatch
+    size_t nextBasket = 0;
+    auto dispatch = [&](size_t from, size_t to) {
+        for (size_t i = from; i < to;) {
+            if (nextBasket < baskets.size() && baskets[nextBasket].first == i) {
+                scheduler.submitBasket(&orders[i], baskets[nextBasket].second);
+                i += baskets[nextBasket++].second;
+            } else {
+                scheduler.submit(*orders[i].target, orders[i].order);
+                ++i;
+            }
+        }
+    };
+    dispatch(0, openAt);
+    double openSeconds = 0.0;
+    long long openVolume = 0;
+    if (scheduler.getSymbols().front()->book.inAuction()) {
+        uint64_t openStarted = TscClock::now();
+        openVolume = scheduler.openingCross(openFills);
+        openSeconds = TscClock::seconds(TscClock::nowOrdered() - openStarted);
+    }
+    dispatch(openAt, orders.size());
+    scheduler.finish();
+    double seconds = TscClock::seconds(TscClock::nowOrdered() - started);
+    if (fillsFile.is_open()) scheduler.finish(fillsFile);  // Already stopped; just writes the fills out
+
+    std::cout << "symbol orders trades volume last open_orders checksum fill_hash\n";
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const SymbolBook& book = *scheduler.getSymbols()[i];
+        std::cout << book.symbol << " " << book.processed << " " << stats[i].trades << " " << stats[i].volume << " "
+                  << formatPrice(book.book.getLastTradedPrice()) << " " << book.book.openOrderCount() << " "
+                  << std::hex << book.book.checksum() << " " << stats[i].fillHash << std::dec << "\n";
+    }
+    std::cout << "Processed " << orders.size() << " orders for " << stats.size() << " symbols on " << threadCount
+              << (stealing ? " work-stealing" : " static") << " threads in " << seconds << "s ("
+              << static_cast<long long>(seconds > 0 ? orders.size() / seconds : 0) << " orders/s), "
+              << scheduler.migrations() << " migrations\n";
+    if (!baskets.empty() || rejectedBaskets > 0) {
+        std::cout << "Baskets: " << baskets.size() << " dispatched, " << rejectedBaskets << " rejected\n";
+    }
+    if (openSeconds > 0) {
+        std::cout << "Opening cross: " << openVolume << " shares in " << openSeconds * 1000 << " ms (drain and uncross)\n";
+    }
+    for (size_t i = 0; i < scheduler.workerCount(); ++i) {
+        std::cout << "Worker " << i << ": " << scheduler.ordersRunBy(i) << " orders, " << scheduler.stealsBy(i)
+                  << " steals\n";
+    }
+    return 0;
+}
@@ -0,0 +1,197 @@
+#ifndef EXECUTION_H
+#define EXECUTION_H
+
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "orderbook.h"
+
+// Parent orders worked by an execution algorithm. The parent is never placed in the
+// book itself; on each timer it cancels whatever is left of its previous child and
+// sends a new child sized to catch up with its schedule:
+//   TWAP  equal slices between start and end time
+//   VWAP  slices weighted by an expected volume curve (U-shaped by default)
+//   POV   a fixed share of the volume the rest of the market trades; besides the
+//         regular timer it wakes up early whenever market fills open a large enough gap
+// Children are named <parentId>.<n> and carry the parent's limit price, or are market
+// orders if the parent has none. Scheduling runs on OrderBook timers, so everything
+// happens on the simulated clock.
+
+enum class AlgoType { TWAP, VWAP, POV };
+
+struct ParentOrderSpec {
+    std::string id;
+    char type = 'B';
+    int quantity = 0;
+    AlgoType algo = AlgoType::TWAP;
+    int startTime = 1;
+    int endTime = 1;
+    int interval = 1;                 // Time between scheduled slices
+    bool hasLimit = false;
+    double limitPrice = 0.0;
+    double participation = 0.1;       // POV target share of total volume
+    std::vector<double> volumeCurve;  // VWAP weight per slice; empty means U-shaped
+};
+
+// Parses "<id> <B|S> <qty> <TWAP|VWAP|POV> <start> <end> <interval> [limit=<price>]
+// [rate=<share>] [curve=<w1,w2,...>]". Returns false if the spec is malformed.
+inline bool parseParentOrder(const std::string& text, ParentOrderSpec& spec) {
+    std::istringstream iss(text);
+    std::string algo;
+    if (!(iss >> spec.id >> spec.type >> spec.quantity >> algo >> spec.startTime >> spec.endTime >> spec.interval)) {
+        return false;
+    }
+    if (algo == "TWAP") spec.algo = AlgoType::TWAP;
+    else if (algo == "VWAP") spec.algo = AlgoType::VWAP;
+    else if (algo == "POV") spec.algo = AlgoType::POV;
+    else return false;
+
+    std::string option;
+    while (iss >> option) {
+        size_t eq = option.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = option.substr(0, eq), value = option.substr(eq + 1);
+        if (key == "limit") {
+            spec.hasLimit = true;
+            spec.limitPrice = std::stod(value);
+        } else if (key == "rate") {
+            spec.participation = std::stod(value);
+        } else if (key == "curve") {
+            std::istringstream weights(value);
+            std::string weight;
+            while (std::getline(weights, weight, ',')) spec.volumeCurve.push_back(std::stod(weight));
+        } else {
+            return false;
+        }
+    }
+    return (spec.type == 'B' || spec.type == 'S') && spec.quantity > 0 && spec.interval > 0 &&
+           spec.endTime >= spec.startTime && spec.participation > 0.0 && spec.participation < 1.0;
+}
+
+inline const char* algoName(AlgoType algo) {
+    return algo == AlgoType::TWAP ? "TWAP" : (algo == AlgoType::VWAP ? "VWAP" : "POV");
+}
+
+class ParentOrder {
+    OrderBook& book;
+    std::ostream& output;
+    ParentOrderSpec spec;
+    std::vector<double> cumulativeShare;  // TWAP/VWAP: share of the parent due by each slice
+
+    int filled = 0;
+    double notional = 0.0;
+    int children = 0;
+    int slice = 0;
+    std::string activeChild;      // Only one child is live at a time
+    long long marketVolume = 0;   // Volume traded by others since the start (POV)
+    bool wakeupPending = false;
+    bool finished = false;
+
+public:
+    // Book and output must outlive the parent; the parent must not move once started
+    ParentOrder(OrderBook& orderBook, std::ostream& out, const ParentOrderSpec& parentSpec)
+        : book(orderBook), output(out), spec(parentSpec) {
+        int slices = (spec.endTime - spec.startTime) / spec.interval + 1;
+        std::vector<double> weights(slices, 1.0);
+        if (spec.algo == AlgoType::VWAP) {
+            for (int i = 0; i < slices; ++i) {
+                if (i < static_cast<int>(spec.volumeCurve.size())) {
+                    weights[i] = spec.volumeCurve[i];
+                } else {
+                    double x = (i + 0.5) / slices - 0.5;  // Busy open and close, quiet midday
+                    weights[i] = 1.0 + 4.0 * x * x;
+                }
+            }
+        }
+        double total = 0.0;
+        for (double w : weights) total += w;
+        double running = 0.0;
+        for (double w : weights) {
+            running += w;
+            cumulativeShare.push_back(total > 0 ? running / total : 1.0);
+        }
+    }
+
+    ParentOrder(const ParentOrder&) = delete;
+    ParentOrder& operator=(const ParentOrder&) = delete;
+
+    void start() {
+        book.addFillListener([this](const Fill& fill) { onFill(fill); });
+        book.scheduleTimer(spec.startTime, [this] { onTimer(true); });
+    }
+
+    const ParentOrderSpec& getSpec() const { return spec; }
+    int filledQuantity() const { return filled; }
+    int childCount() const { return children; }
+    double averagePrice() const { return filled > 0 ? notional / filled : 0.0; }
+    bool isFinished() const { return finished; }
+
+private:
+    bool isChild(const std::string& id) const {
+        return id.size() > spec.id.size() && id.compare(0, spec.id.size(), spec.id) == 0 && id[spec.id.size()] == '.';
+    }
+
+    void onFill(const Fill& fill) {
+        const std::string& ours = spec.type == 'B' ? fill.buyId : fill.sellId;
+        if (isChild(ours)) {
+            filled += fill.quantity;
+            notional += fill.price * fill.quantity;
+            return;
+        }
+        if (spec.algo != AlgoType::POV || finished || fill.timestamp < spec.startTime) return;
+        marketVolume += fill.quantity;
+        // Matching is still running, so the top-up waits for a timer at the current time
+        if (!wakeupPending && target() - filled >= std::max(1, spec.quantity / 100)) {
+            wakeupPending = true;
+            book.scheduleTimer(fill.timestamp, [this] { onTimer(false); });
+        }
+    }
+
+    // Quantity that should have been executed by now
+    int target() const {
+        if (spec.algo == AlgoType::POV) {
+            double due = spec.participation / (1.0 - spec.participation) * marketVolume;
+            return std::min(spec.quantity, static_cast<int>(std::ceil(due)));
+        }
+        size_t index = std::min(static_cast<size_t>(slice), cumulativeShare.size() - 1);
+        return static_cast<int>(std::llround(spec.quantity * cumulativeShare[index]));
+    }
+
+    void onTimer(bool scheduled) {
+        if (!scheduled) wakeupPending = false;
+        if (finished) return;
+        int now = book.getCurrentTime();
+        if (!activeChild.empty()) book.cancelOrder(activeChild);
+        activeChild.clear();
+
+        bool last = now >= spec.endTime;
+        int wanted = std::min(spec.quantity, last && spec.algo != AlgoType::POV ? spec.quantity : target());
+        if (wanted > filled) sendChild(wanted - filled, now);
+
+        if (scheduled) {
+            ++slice;
+            if (last || filled >= spec.quantity) {
+                finished = true;
+            } else {
+                book.scheduleTimer(std::min(now + spec.interval, spec.endTime), [this] { onTimer(true); });
+            }
+        }
+    }
+
+    void sendChild(int quantity, int now) {
+        Order child;
+        child.id = spec.id + "." + std::to_string(++children);
+        child.type = spec.type;
+        child.quantity = quantity;
+        child.isMarketOrder = !spec.hasLimit;
+        child.limitPrice = spec.hasLimit ? spec.limitPrice : 0;
+        child.timestamp = now;
+        activeChild = child.id;
+        book.submit(child, output);
+        if (!book.isResting(activeChild)) activeChild.clear();
+    }
+};
+
+#endif
@@ -0,0 +1,62 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "market_data.h"
+#include "book_replica.h"
+
+// Follows the UDP feed and keeps a local replica of the book, filling gaps from the
+// publisher's retransmission service and joining from a snapshot if started late.
+// Reports the replica's state and how its checksums compared with the engine's.
+//   ./feedlisten [--group G] [--port P] [--retransmit-port R]
+int main(int argc, char* argv[]) {
+    FeedConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--group") config.group = argv[i + 1];
+        else if (arg == "--port") config.port = static_cast<uint16_t>(std::atoi(argv[i + 1]));
+        else if (arg == "--retransmit-port") config.retransmitPort = static_cast<uint16_t>(std::atoi(argv[i + 1]));
+        else {
+            std::cerr << "Usage: ./feedlisten [--group G] [--port P] [--retransmit-port R]\n";
+            return 1;
+        }
+    }
+    if (argc % 2 == 0) {
+        std::cerr << "Usage: ./feedlisten [--group G] [--port P] [--retransmit-port R]\n";
+        return 1;
+    }
+
+    BookReplica replica;
+    FeedSubscriber subscriber(config, replica);
+    if (!subscriber.open()) {
+        std::cerr << "Error: Could not join " << config.group << ":" << config.port << "\n";
+        return 1;
+    }
+    long long updates = 0, trades = 0;
+    bool finished = subscriber.run([&](const FeedMessage& message) {
+        if (message.type == FeedOrderUpdate) ++updates;
+        else if (message.type == FeedTrade) ++trades;
+    });
+
+    std::cout << "Applied up to message " << replica.nextExpected() - 1 << " (" << updates << " order updates, "
+              << trades << " trades); " << subscriber.gaps << " gaps, " << subscriber.recovered
+              << " messages recovered, " << subscriber.snapshots << " snapshots loaded\n";
+    double bid = 0, ask = 0;
+    long long bidSize = 0, askSize = 0;
+    std::cout << "Replica: " << replica.orderCount() << " resting orders, best bid ";
+    if (replica.bestBid(bid, bidSize)) std::cout << formatPrice(bid) << " x " << bidSize;
+    else std::cout << "-";
+    std::cout << ", best ask ";
+    if (replica.bestAsk(ask, askSize)) std::cout << formatPrice(ask) << " x " << askSize;
+    else std::cout << "-";
+    std::cout << ", last trade " << formatPrice(replica.lastTradePrice()) << "\n";
+    if (replica.indicativeUpdates() > 0) {
+        const AuctionCross& cross = replica.lastIndicative();
+        std::cout << "Indicative: " << replica.indicativeUpdates() << " updates, last " << formatPrice(cross.price)
+                  << " for " << cross.volume << " shares, imbalance " << cross.imbalance << "\n";
+    }
+    std::cout << "Checksums: " << replica.checksPassed() << " matched, " << replica.checksMismatched()
+              << " mismatched\n";
+    if (!finished) std::cout << "Session end not seen\n";
+    return finished && replica.checksMismatched() == 0 ? 0 : 1;
+}
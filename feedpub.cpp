@@ -0,0 +1,107 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "orderbook.h"
+#include "market_data.h"
+#include "tsc_clock.h"
+
+// Replays an input file at full speed and publishes the resulting order updates and
+// trades on the UDP feed (see market_data.h), serving gap fills over TCP.
+//   ./feedpub [--group G] [--port P] [--retransmit-port R] [--flush-every N]
+//             [--linger MS] [--drop N] [--checksum-every N] [--snapshot-every N]
+//             [--indicative-every T] <input_file>
+// By default datagrams are only sent once full; --flush-every N also sends after every
+// N orders. A book checksum is published every 1000 orders and a snapshot for late
+// joiners is refreshed every 10000 (both adjustable). The retransmission service stays
+// up for --linger milliseconds (default 2000) after the session ends so late listeners
+// can still fill gaps.
+// If the input has an OPEN line, the orders before it rest for the opening auction
+// while indicative price, volume and imbalance go out at most every T orders (default
+// 10); the book uncrosses at OPEN.
+int main(int argc, char* argv[]) {
+    FeedConfig config;
+    int flushEvery = 0;
+    int lingerMs = 2000;
+    int checksumEvery = 1000;
+    int snapshotEvery = 10000;
+    std::string inputFilename;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--group" && hasValue) config.group = argv[++i];
+        else if (arg == "--port" && hasValue) config.port = static_cast<uint16_t>(std::atoi(argv[++i]));
+        else if (arg == "--retransmit-port" && hasValue) config.retransmitPort = static_cast<uint16_t>(std::atoi(argv[++i]));
+        else if (arg == "--flush-every" && hasValue) flushEvery = std::atoi(argv[++i]);
+        else if (arg == "--linger" && hasValue) lingerMs = std::atoi(argv[++i]);
+        else if (arg == "--drop" && hasValue) config.dropEvery = std::atoi(argv[++i]);
+        else if (arg == "--checksum-every" && hasValue) checksumEvery = std::atoi(argv[++i]);
+        else if (arg == "--snapshot-every" && hasValue) snapshotEvery = std::atoi(argv[++i]);
+        else if (arg == "--indicative-every" && hasValue) config.indicativeInterval = std::atoi(argv[++i]);
+        else if (inputFilename.empty()) inputFilename = arg;
+        else inputFilename.clear(), i = argc;
+    }
+    if (inputFilename.empty()) {
+        std::cerr << "Usage: ./feedpub [--group G] [--port P] [--retransmit-port R] [--flush-every N] "
+                     "[--linger MS] [--drop N] [--checksum-every N] [--snapshot-every N] "
+                     "[--indicative-every T] <input_file>\n";
+        return 1;
+    }
+    std::ifstream inputFile(inputFilename);
+    if (!inputFile) {
+        std::cerr << "Error: Could not open file " << inputFilename << "\n";
+        return 1;
+    }
+    FeedPublisher publisher(config);
+    if (!publisher.open()) {
+        std::cerr << "Error: Could not open feed sockets\n";
+        return 1;
+    }
+
+    double initialPrice;
+    inputFile >> initialPrice;
+    inputFile.ignore();
+    OrderBook orderBook(initialPrice);
+    {
+        std::ifstream scan(inputFilename);
+        std::string line;
+        while (std::getline(scan, line)) {
+            if (line == "OPEN") {
+                orderBook.startAuction();
+                break;
+            }
+        }
+    }
+    publisher.attach(orderBook);
+    publisher.storeSnapshot(orderBook);
+
+    std::ostream discard(nullptr);
+    std::string line;
+    int timestamp = 0;
+    uint64_t started = TscClock::now();
+    while (std::getline(inputFile, line)) {
+        ++timestamp;
+        if (line == "OPEN") {
+            orderBook.advanceTo(timestamp);
+            orderBook.uncross(discard);
+        } else {
+            orderBook.submit(parseOrder(line, timestamp), discard);
+        }
+        publisher.publishChanges(orderBook);
+        publisher.publishIndicative(orderBook);
+        if (checksumEvery > 0 && timestamp % checksumEvery == 0) publisher.publishChecksum(orderBook);
+        if (snapshotEvery > 0 && timestamp % snapshotEvery == 0) publisher.storeSnapshot(orderBook);
+        if (flushEvery > 0 && timestamp % flushEvery == 0) publisher.flush();
+    }
+    publisher.publishChecksum(orderBook);
+    publisher.endSession(timestamp);
+    double seconds = TscClock::seconds(TscClock::nowOrdered() - started);
+
+    std::cout << "Published " << publisher.messagesPublished() << " messages in " << publisher.datagramsSent()
+              << " datagrams for " << timestamp << " orders in " << seconds << "s\n";
+    std::this_thread::sleep_for(std::chrono::milliseconds(lingerMs));
+    return 0;
+}
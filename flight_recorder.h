@@ -0,0 +1,231 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "tsc_clock.h"
+
+// Flight recorder: the last N engine events (orders in, cancels, fills, top-of-book
+// changes) kept in a fixed ring of plain 80-byte records. Recording one is a TSC read and
+// a few stores into a slot that is already allocated, so it can stay on for a whole
+// production replay. Nothing is written out until something goes wrong: a crash signal,
+// SIGINT/SIGTERM, SIGUSR1 (dump and carry on) or a failed invariant check (dump()).
+//
+// The ring is plain data, so the signal handler can write it with nothing but write(2).
+// Ids longer than 19 characters are cut short. One writer only: give each book (or each
+// thread) its own recorder. ./flightdump prints a dump file as text.
+
+enum FlightEventKind : uint8_t { FlightOrder = 1, FlightCancel, FlightFill, FlightTop };
+
+struct FlightEvent {
+    uint64_t tsc;       // TscClock::now() when recorded
+    int32_t time;       // Book time (order timestamp)
+    uint8_t kind;       // FlightEventKind
+    char side;          // Order/cancel: 'B' or 'S'
+    uint8_t market;     // Order: 1 for a market order
+    uint8_t reserved;
+    int64_t price;      // Ticks. Order: limit; fill: execution; top: best bid (-1 if none)
+    int64_t price2;     // Top: best ask (-1 if none)
+    int32_t quantity;   // Order: size; fill: traded; top: bid quantity
+    int32_t quantity2;  // Top: ask quantity
+    char id[20];        // Order/cancel: the order; fill: the buyer
+    char id2[20];       // Fill: the seller
+};
+
+static_assert(std::is_trivially_copyable<FlightEvent>::value, "FlightEvent is written raw");
+static_assert(sizeof(FlightEvent) == 80, "FlightEvent layout is part of the dump format");
+
+// Start of a dump file; `count` events follow, oldest first
+struct FlightDumpHeader {
+    char magic[8];          // "FLIGHT1"
+    uint64_t count;         // Events in this file
+    uint64_t recorded;      // Events recorded since the start (older ones were overwritten)
+    double nanosPerTick;    // To turn FlightEvent::tsc differences into nanoseconds
+    char reason[64];        // Why the dump was taken
+};
+
+class FlightRecorder {
+    std::unique_ptr<FlightEvent[]> ring;
+    uint64_t mask;
+    uint64_t head = 0;  // Events recorded so far; the next goes to ring[head & mask]
+    double nanosPerTick;
+
+public:
+    // Keeps the last `capacity` events (rounded up to a power of two)
+    explicit FlightRecorder(size_t capacity = 65536) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        ring.reset(new FlightEvent[size]());
+        mask = size - 1;
+        nanosPerTick = TscClock::nanoseconds(1);  // Calibrates now, never in a signal handler
+    }
+
+    void order(int time, const std::string& id, char side, bool market, double price, int quantity) {
+        FlightEvent& event = next(FlightOrder, time);
+        event.side = side;
+        event.market = market ? 1 : 0;
+        event.price = market ? 0 : ticks(price);
+        event.quantity = quantity;
+        copyId(event.id, id);
+    }
+
+    void cancel(int time, const std::string& id, char side) {
+        FlightEvent& event = next(FlightCancel, time);
+        event.side = side;
+        copyId(event.id, id);
+    }
+
+    void fill(int time, const std::string& buyId, const std::string& sellId, int quantity, double price) {
+        FlightEvent& event = next(FlightFill, time);
+        event.price = ticks(price);
+        event.quantity = quantity;
+        copyId(event.id, buyId);
+        copyId(event.id2, sellId);
+    }
+
+    // The best levels after a change (ticks -1 for an empty side)
+    void top(int time, long long bidTicks, long long bidQuantity, long long askTicks, long long askQuantity) {
+        FlightEvent& event = next(FlightTop, time);
+        event.price = bidTicks;
+        event.price2 = askTicks;
+        event.quantity = clampQuantity(bidQuantity);
+        event.quantity2 = clampQuantity(askQuantity);
+    }
+
+    uint64_t recorded() const { return head; }
+    size_t capacity() const { return static_cast<size_t>(mask + 1); }
+
+    // Writes the ring to `path`, oldest event first; returns false if the file could not
+    // be written. Only uses open/write/close, so it is safe in a signal handler.
+    bool dump(const char* path, const char* reason) const {
+        int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        FlightDumpHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "FLIGHT1", 8);
+        header.count = std::min<uint64_t>(head, mask + 1);
+        header.recorded = head;
+        header.nanosPerTick = nanosPerTick;
+        for (size_t i = 0; reason[i] != '\0' && i + 1 < sizeof(header.reason); ++i) header.reason[i] = reason[i];
+        uint64_t split = head > mask ? head & mask : 0;  // Slot of the oldest event
+        bool ok = writeAll(fd, &header, sizeof(header)) &&
+                  writeAll(fd, ring.get() + split, (header.count - split) * sizeof(FlightEvent)) &&
+                  writeAll(fd, ring.get(), split * sizeof(FlightEvent));
+        ::close(fd);
+        return ok;
+    }
+
+    // Reads a dump back; false if `path` is not one
+    static bool load(const std::string& path, FlightDumpHeader& header, std::vector<FlightEvent>& events) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            std::memcmp(header.magic, "FLIGHT1", 8) != 0) {
+            return false;
+        }
+        header.reason[sizeof(header.reason) - 1] = '\0';
+        events.resize(header.count);
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(events.data()),
+                                           static_cast<std::streamsize>(events.size() * sizeof(FlightEvent))));
+    }
+
+    // Dumps `recorder` to `path` when the process crashes (SIGSEGV, SIGBUS, SIGFPE,
+    // SIGILL, SIGABRT, so also std::terminate), is interrupted or terminated, and on
+    // SIGUSR1, which leaves it running. One recorder per process; call again to replace it.
+    static void installSignalHandlers(const FlightRecorder& recorder, const std::string& path) {
+        signalState().recorder = &recorder;
+        std::memset(signalState().path, 0, sizeof(signalState().path));
+        path.copy(signalState().path, sizeof(signalState().path) - 1);
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        sigemptyset(&action.sa_mask);
+        action.sa_handler = onFatalSignal;
+        action.sa_flags = SA_RESETHAND;  // Back to the default, which the handler then re-raises
+        for (int signal : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGINT, SIGTERM}) {
+            sigaction(signal, &action, nullptr);
+        }
+        action.sa_handler = onDumpSignal;
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &action, nullptr);
+    }
+
+private:
+    struct SignalState {
+        const FlightRecorder* recorder = nullptr;
+        char path[256] = {};
+    };
+
+    static SignalState& signalState() {
+        static SignalState state;
+        return state;
+    }
+
+    static void onFatalSignal(int signal) {
+        const SignalState& state = signalState();
+        if (state.recorder) state.recorder->dump(state.path, signalName(signal));
+        ::raise(signal);
+    }
+
+    static void onDumpSignal(int signal) {
+        const SignalState& state = signalState();
+        if (state.recorder) state.recorder->dump(state.path, signalName(signal));
+    }
+
+    static const char* signalName(int signal) {
+        switch (signal) {
+            case SIGSEGV: return "signal SIGSEGV";
+            case SIGBUS: return "signal SIGBUS";
+            case SIGFPE: return "signal SIGFPE";
+            case SIGILL: return "signal SIGILL";
+            case SIGABRT: return "signal SIGABRT";
+            case SIGINT: return "signal SIGINT";
+            case SIGTERM: return "signal SIGTERM";
+            case SIGUSR1: return "signal SIGUSR1";
+            default: return "signal";
+        }
+    }
+
+    FlightEvent& next(FlightEventKind kind, int time) {
+        FlightEvent& event = ring[head++ & mask];
+        event = FlightEvent{};
+        event.tsc = TscClock::now();
+        event.time = time;
+        event.kind = kind;
+        return event;
+    }
+
+    static int64_t ticks(double price) { return static_cast<int64_t>(std::llround(price * 100.0)); }
+
+    static int32_t clampQuantity(long long quantity) {
+        return static_cast<int32_t>(std::min<long long>(quantity, INT32_MAX));
+    }
+
+    static void copyId(char (&target)[20], const std::string& id) {
+        size_t length = std::min(id.size(), sizeof(target) - 1);
+        std::memcpy(target, id.data(), length);
+    }
+
+    static bool writeAll(int fd, const void* data, size_t bytes) {
+        const char* from = static_cast<const char*>(data);
+        while (bytes > 0) {
+            ssize_t written = ::write(fd, from, bytes);
+            if (written <= 0) return false;
+            from += written;
+            bytes -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+};
+
+#endif
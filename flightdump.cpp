@@ -0,0 +1,67 @@
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "flight_recorder.h"
+#include "orderbook.h"
+
+// Prints a flight recorder dump (flight_recorder.h) as text, oldest event first.
+//   ./flightdump flight.rec [last_n]
+// Each line starts with the book time and the nanoseconds since the first event shown.
+int main(int argc, char* argv[]) {
+    size_t last = 0;
+    bool lastValid = true;
+    if (argc == 3) {
+        char* end = nullptr;
+        errno = 0;
+        last = std::strtoul(argv[2], &end, 10);
+        // strtoul takes a sign and leading spaces; last_n is plain digits
+        lastValid = std::isdigit(static_cast<unsigned char>(argv[2][0])) && *end == '\0' && errno != ERANGE;
+    }
+    if (argc < 2 || argc > 3 || !lastValid) {
+        std::cerr << "Usage: ./flightdump <dump_file> [last_n]\n";
+        return 1;
+    }
+    FlightDumpHeader header;
+    std::vector<FlightEvent> events;
+    if (!FlightRecorder::load(argv[1], header, events)) {
+        std::cerr << "Error: " << argv[1] << " is not a flight recorder dump\n";
+        return 1;
+    }
+    size_t first = 0;
+    if (argc == 3 && last < events.size()) first = events.size() - last;
+    std::cout << "Reason: " << header.reason << "\n"
+              << events.size() << " events (" << header.recorded << " recorded), showing " << events.size() - first
+              << "\n";
+    auto price = [](int64_t ticks) { return ticks < 0 ? std::string("-") : formatPrice(ticks / 100.0); };
+    for (size_t i = first; i < events.size(); ++i) {
+        const FlightEvent& event = events[i];
+        double nanos = static_cast<double>(event.tsc - events[first].tsc) * header.nanosPerTick;
+        std::cout << std::setw(8) << event.time << " +" << std::setw(12) << static_cast<long long>(nanos) << "ns  ";
+        switch (event.kind) {
+            case FlightOrder:
+                std::cout << "ORDER  " << event.id << " " << event.side << " " << event.quantity << " "
+                          << (event.market ? "MKT" : price(event.price));
+                break;
+            case FlightCancel:
+                std::cout << "CANCEL " << event.id << " " << event.side;
+                break;
+            case FlightFill:
+                std::cout << "FILL   " << event.id << " / " << event.id2 << " " << event.quantity << " @ "
+                          << price(event.price);
+                break;
+            case FlightTop:
+                std::cout << "TOP    " << event.quantity << " @ " << price(event.price) << "  x  " << event.quantity2
+                          << " @ " << price(event.price2);
+                break;
+            default:
+                std::cout << "?";
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+#ifndef FLOW_PARAMS_H
+#define FLOW_PARAMS_H
+
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Order-flow statistics shared by the calibration tool (which estimates them from an
+// existing input file) and the synthetic generators (which draw orders from them).
+//
+// Order time is the line number, so rates are per event. Limit prices are described as
+// an offset in cents from a reference price: the exponential moving average of recent
+// limit prices (see ReferencePrice). Offsets are signed towards the passive side, so a
+// buy below the reference or a sell above it is positive and a crossing order negative.
+// Distributions are stored as 21 quantiles (0%, 5%, ..., 100%) and sampled by
+// interpolating the inverse CDF.
+
+// EMA of limit prices used as the reference for price offsets
+struct ReferencePrice {
+    static constexpr double smoothing = 1.0 / 64.0;
+    // Lines of history needed for the EMA to forget its starting point
+    static constexpr int warmupLines = 256;
+
+    double value = 0.0;
+    bool seeded = false;
+
+    void update(double limitPrice) {
+        if (!seeded) {
+            value = limitPrice;
+            seeded = true;
+        } else {
+            value += smoothing * (limitPrice - value);
+        }
+    }
+};
+
+// Signed passive-side offset of a limit price from the reference, in cents
+inline long long priceOffsetTicks(char type, double limitPrice, double reference) {
+    return std::llround((type == 'B' ? reference - limitPrice : limitPrice - reference) * 100.0);
+}
+
+// 21 quantiles of an integer-valued histogram
+inline std::vector<double> quantilesFromHistogram(const std::map<long long, long long>& histogram) {
+    long long total = 0;
+    for (const auto& bucket : histogram) total += bucket.second;
+    std::vector<double> quantiles;
+    if (total == 0) return quantiles;
+
+    auto bucket = histogram.begin();
+    long long seen = bucket->second;
+    for (int i = 0; i <= 20; ++i) {
+        long long rank = static_cast<long long>(std::llround(i / 20.0 * (total - 1)));
+        while (seen <= rank) {
+            ++bucket;
+            seen += bucket->second;
+        }
+        quantiles.push_back(static_cast<double>(bucket->first));
+    }
+    return quantiles;
+}
+
+// Inverse-CDF sample for u in [0, 1) from a quantile table
+inline double sampleQuantiles(const std::vector<double>& quantiles, double u) {
+    if (quantiles.empty()) return 0.0;
+    if (quantiles.size() == 1) return quantiles[0];
+    double position = u * (quantiles.size() - 1);
+    size_t lower = static_cast<size_t>(position);
+    if (lower >= quantiles.size() - 1) return quantiles.back();
+    double fraction = position - lower;
+    return quantiles[lower] + fraction * (quantiles[lower + 1] - quantiles[lower]);
+}
+
+struct FlowParams {
+    long long events = 0;
+    double openPrice = 10.0;
+    double buyShare = 0.5;      // Fraction of events that are new buy orders
+    double sellShare = 0.5;     // Fraction of events that are new sell orders
+    double cancelShare = 0.0;   // Fraction of events that are cancels
+    double marketShare = 0.0;   // Fraction of new orders sent without a limit price
+    std::vector<double> sizeQuantiles{100.0};
+    std::vector<double> offsetQuantiles{0.0};         // Cents, see priceOffsetTicks
+    std::vector<double> cancelLifetimeQuantiles{1.0}; // Events between an order and its cancel
+
+    bool save(const std::string& path, const std::string& source) const {
+        std::ofstream out(path);
+        if (!out) return false;
+        out << "# Order-flow parameters estimated from " << source << "\n";
+        out << "events " << events << "\n";
+        out << "open_price " << openPrice << "\n";
+        out << "buy_share " << buyShare << "\n";
+        out << "sell_share " << sellShare << "\n";
+        out << "cancel_share " << cancelShare << "\n";
+        out << "market_share " << marketShare << "\n";
+        writeList(out, "size_quantiles", sizeQuantiles);
+        writeList(out, "offset_quantiles", offsetQuantiles);
+        writeList(out, "cancel_lifetime_quantiles", cancelLifetimeQuantiles);
+        return static_cast<bool>(out);
+    }
+
+    // Reads a parameter file; keys that are missing keep their defaults and unknown keys
+    // are ignored so generators can add their own settings to the same file
+    bool load(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) return false;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream iss(line);
+            std::string key;
+            iss >> key;
+            if (key == "events") iss >> events;
+            else if (key == "open_price") iss >> openPrice;
+            else if (key == "buy_share") iss >> buyShare;
+            else if (key == "sell_share") iss >> sellShare;
+            else if (key == "cancel_share") iss >> cancelShare;
+            else if (key == "market_share") iss >> marketShare;
+            else if (key == "size_quantiles") readList(iss, sizeQuantiles);
+            else if (key == "offset_quantiles") readList(iss, offsetQuantiles);
+            else if (key == "cancel_lifetime_quantiles") readList(iss, cancelLifetimeQuantiles);
+        }
+        return true;
+    }
+
+private:
+    static void writeList(std::ostream& out, const char* key, const std::vector<double>& values) {
+        out << key;
+        for (double value : values) out << " " << value;
+        out << "\n";
+    }
+
+    static void readList(std::istream& in, std::vector<double>& values) {
+        std::vector<double> parsed;
+        double value;
+        while (in >> value) parsed.push_back(value);
+        if (!parsed.empty()) values = parsed;
+    }
+};
+
+#endif
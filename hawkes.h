@@ -0,0 +1,191 @@
+#ifndef HAWKES_H
+#define HAWKES_H
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "orderbook.h"
+#include "flow_params.h"
+#include "philox.h"
+
+// Self-exciting order flow: a three-dimensional Hawkes process over buy, sell and cancel
+// events with exponential kernels. The intensity of event type i is
+//     lambda_i(t) = mu_i + sum_j alpha[i][j] * sum_{events k of type j, t_k < t} exp(-beta (t - t_k))
+// so every event raises the near-term rate of the types it excites, producing the
+// bursts Poisson arrivals miss. With a shared beta the inner sums decay together and
+// can be kept as one running value per type, which makes simulation O(1) per event.
+//
+// The process runs in continuous time (HawkesOrderFlow::eventTime(), scaled so the
+// long-run event rate is 1), but Order::timestamp is only the event's sequence number, as for
+// any input file. A burst in the emitted orders therefore shows as a run of the excited
+// types, not as orders arriving closer together; anything that needs the arrival rate
+// itself has to pace the events by eventTime().
+
+enum HawkesEvent { HawkesBuy = 0, HawkesSell = 1, HawkesCancel = 2 };
+
+// Excitation settings, read from the same parameter file as FlowParams
+struct HawkesParams {
+    double beta = 1.0;
+    // alpha[i][j]: excitation of type i by an event of type j (buy, sell, cancel)
+    double alpha[3][3] = {{0.45, 0.10, 0.05},
+                          {0.10, 0.45, 0.05},
+                          {0.15, 0.15, 0.30}};
+
+    // Reads "hawkes_beta <b>" and "hawkes_alpha <9 values, row by row>" if present
+    bool load(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) return false;
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream iss(line);
+            std::string key;
+            iss >> key;
+            if (key == "hawkes_beta") {
+                iss >> beta;
+            } else if (key == "hawkes_alpha") {
+                for (auto& row : alpha) {
+                    for (double& value : row) iss >> value;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+// Generates orders whose event types follow the Hawkes process and whose sizes, prices
+// and cancel lifetimes follow the calibrated FlowParams. Base rates are solved so that
+// the long-run event shares match the calibration: with branching matrix G = alpha/beta
+// the stationary rates are (I - G)^-1 mu, so mu = (I - G) * shares.
+// Random draws come from the seed's Philox stream `stream` (philox.h), so generators with
+// different stream ids are independent and each one's output depends on nothing else.
+class HawkesOrderFlow {
+    FlowParams flow;
+    HawkesParams hawkes;
+    double baseRate[3];
+    double excitation[3] = {0.0, 0.0, 0.0};  // Decayed event counts per type
+    double clock = 0.0;                      // Process time of the last event
+    PhiloxStream rng;
+
+    ReferencePrice reference;
+    int timestamp = 0;
+    long long nextId = 0;
+    std::map<int, std::string> candidates;  // Cancel targets by arrival time; pruned lazily
+
+public:
+    HawkesOrderFlow(const FlowParams& flowParams, const HawkesParams& hawkesParams, uint64_t seed, uint64_t stream = 0)
+        : flow(flowParams), hawkes(hawkesParams), rng(seed, stream) {
+        double shares[3] = {flow.buyShare, flow.sellShare, flow.cancelShare};
+        double totalShare = shares[0] + shares[1] + shares[2];
+        for (double& share : shares) share = totalShare > 0 ? share / totalShare : 1.0 / 3.0;
+        for (int i = 0; i < 3; ++i) {
+            baseRate[i] = shares[i];
+            for (int j = 0; j < 3; ++j) baseRate[i] -= hawkes.alpha[i][j] / hawkes.beta * shares[j];
+            // An excitation this strong cannot be matched exactly; keep a small floor
+            baseRate[i] = std::max(baseRate[i], 1e-3 * shares[i] + 1e-9);
+        }
+        reference.update(flow.openPrice);
+    }
+
+    // Produces the next event. The book is the one the events are fed to; it is used to
+    // pick cancel targets that are still resting.
+    Order next(const OrderBook& book) {
+        int type = nextEventType();
+        Order order;
+        order.timestamp = ++timestamp;
+        if (type == HawkesCancel && pickCancelTarget(book, order.id)) {
+            excitation[HawkesCancel] += 1.0;
+            order.type = 'C';
+            order.quantity = 0;
+            order.isMarketOrder = false;
+            order.limitPrice = 0;
+            return order;
+        }
+        if (type == HawkesCancel) {
+            // Nothing left to cancel: fall back to a new order on a random side
+            type = rng.uniform() * (flow.buyShare + flow.sellShare) < flow.buyShare ? HawkesBuy : HawkesSell;
+        }
+        excitation[type] += 1.0;  // What was emitted, so the intensities follow the real flow
+
+        order.id = "h" + std::to_string(nextId++);
+        order.type = type == HawkesBuy ? 'B' : 'S';
+        order.quantity = std::max(1, static_cast<int>(std::lround(sampleQuantiles(flow.sizeQuantiles, rng.uniform()))));
+        order.isMarketOrder = rng.uniform() < flow.marketShare;
+        order.limitPrice = 0;
+        if (!order.isMarketOrder) {
+            double offset = std::round(sampleQuantiles(flow.offsetQuantiles, rng.uniform())) / 100.0;
+            double price = order.type == 'B' ? reference.value - offset : reference.value + offset;
+            order.limitPrice = std::max(0.01, std::round(price * 100.0) / 100.0);
+            reference.update(order.limitPrice);
+        }
+        pruneCandidates(book);
+        candidates.emplace(order.timestamp, order.id);
+        return order;
+    }
+
+    // Process time of the event next() last returned
+    double eventTime() const { return clock; }
+
+private:
+    // Ogata thinning: between events the intensities only decay, so the total intensity
+    // right now bounds it until the next event. Advances the clock to the event and
+    // returns its type; the caller adds the excitation of what it actually emits.
+    int nextEventType() {
+        while (true) {
+            double bound = totalIntensity();
+            double wait = -std::log(1.0 - rng.uniform()) / bound;
+            clock += wait;
+            double decay = std::exp(-hawkes.beta * wait);
+            for (double& value : excitation) value *= decay;
+
+            double intensity[3];
+            double total = 0.0;
+            for (int i = 0; i < 3; ++i) {
+                intensity[i] = intensityOf(i);
+                total += intensity[i];
+            }
+            double u = rng.uniform() * bound;
+            if (u > total) continue;  // Rejected candidate time
+            return u < intensity[0] ? 0 : (u < intensity[0] + intensity[1] ? 1 : 2);
+        }
+    }
+
+    double intensityOf(int i) const {
+        double value = baseRate[i];
+        for (int j = 0; j < 3; ++j) value += hawkes.alpha[i][j] * excitation[j];
+        return value;
+    }
+
+    double totalIntensity() const {
+        return intensityOf(0) + intensityOf(1) + intensityOf(2);
+    }
+
+    // Chooses the resting order whose age is closest to a sampled cancel lifetime
+    bool pickCancelTarget(const OrderBook& book, std::string& id) {
+        int lifetime = static_cast<int>(std::lround(sampleQuantiles(flow.cancelLifetimeQuantiles, rng.uniform())));
+        while (!candidates.empty()) {
+            auto it = candidates.lower_bound(timestamp - std::max(lifetime, 1));
+            if (it == candidates.end()) --it;
+            if (book.isResting(it->second)) {
+                id = it->second;
+                candidates.erase(it);
+                return true;
+            }
+            candidates.erase(it);  // Filled since it was generated
+        }
+        return false;
+    }
+
+    // Drops filled orders once they make up most of the candidate list
+    void pruneCandidates(const OrderBook& book) {
+        if (candidates.size() < 2 * book.openOrderCount() + 1024) return;
+        for (auto it = candidates.begin(); it != candidates.end();) {
+            it = book.isResting(it->second) ? std::next(it) : candidates.erase(it);
+        }
+    }
+};
+
+#endif
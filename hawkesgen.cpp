@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "orderbook.h"
+#include "flow_params.h"
+#include "hawkes.h"
+#include "trade_store.h"
+
+// Synthetic order flow from a self-exciting (Hawkes) process.
+//   ./hawkesgen <params_file> <events> <output_input_file> [seed]
+//       writes an input file the simulator can read
+//   ./hawkesgen <params_file> <events> --run [seed] [runs] [threads]
+//       feeds the events straight into an OrderBook and reports what happened; with
+//       several runs, each is an independent simulation on its own random stream
+// The parameter file is the one written by ./calibrate, optionally extended with
+// hawkes_beta / hawkes_alpha lines. Orders are numbered, not timed (see hawkes.h); the
+// report gives the process time the events spanned and the most events in one unit of it.
+namespace {
+
+struct RunResult {
+    long long counts[3] = {0, 0, 0};
+    TradeStats session;
+    size_t resting = 0;
+    uint64_t checksum = 0;
+    double duration = 0.0;    // Process time of the last event
+    long long peakRate = 0;   // Most events in one unit of process time
+};
+
+// One generator feeding one book. The book runs even when only writing a file so that
+// cancels always target orders that are still resting.
+RunResult simulate(const FlowParams& flow, const HawkesParams& hawkes, uint64_t seed, uint64_t stream,
+                   long long events, std::ostream* outputFile) {
+    OrderBook orderBook(flow.openPrice);
+    orderBook.setMutationTracking(false);
+    TradeStore tape;
+    if (!outputFile) tape.attach(orderBook);
+    HawkesOrderFlow generator(flow, hawkes, seed, stream);
+
+    std::ostream discard(nullptr);
+    RunResult result;
+    long long unit = 0, inUnit = 0;
+    for (long long i = 0; i < events; ++i) {
+        Order order = generator.next(orderBook);
+        result.counts[order.type == 'B' ? 0 : (order.type == 'S' ? 1 : 2)] += 1;
+        long long now = static_cast<long long>(generator.eventTime());
+        inUnit = now == unit ? inUnit + 1 : 1;
+        unit = now;
+        result.peakRate = std::max(result.peakRate, inUnit);
+        if (outputFile) {
+            *outputFile << order.id << " " << order.type;
+            if (order.type != 'C') {
+                *outputFile << " " << order.quantity;
+                if (!order.isMarketOrder) *outputFile << " " << formatPrice(order.limitPrice);
+            }
+            *outputFile << "\n";
+        }
+        orderBook.submit(order, discard);
+    }
+    if (!outputFile) result.session = tape.summarize();
+    result.resting = orderBook.openOrderCount();
+    result.checksum = orderBook.checksum();
+    result.duration = generator.eventTime();
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 4 || argc > 7 || (argc > 5 && std::string(argv[3]) != "--run")) {
+        std::cerr << "Usage: ./hawkesgen <params_file> <events> <output_input_file> [seed]\n"
+                     "       ./hawkesgen <params_file> <events> --run [seed] [runs] [threads]\n";
+        return 1;
+    }
+    FlowParams flow;
+    HawkesParams hawkes;
+    if (!flow.load(argv[1]) || !hawkes.load(argv[1])) {
+        std::cerr << "Error: Could not open file " << argv[1] << "\n";
+        return 1;
+    }
+    long long events = std::atoll(argv[2]);
+    std::string target = argv[3];
+    uint64_t seed = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 1;
+
+    if (target != "--run") {
+        std::ofstream outputFile(target);
+        if (!outputFile) {
+            std::cerr << "Error: Could not create file " << target << "\n";
+            return 1;
+        }
+        outputFile << formatPrice(flow.openPrice) << "\n";
+        RunResult result = simulate(flow, hawkes, seed, 0, events, &outputFile);
+        std::cout << "Generated " << events << " events: " << result.counts[0] << " buys, " << result.counts[1]
+                  << " sells, " << result.counts[2] << " cancels over " << static_cast<long long>(result.duration)
+                  << " time units (peak " << result.peakRate << " in one)\n";
+        return 0;
+    }
+
+    // Run r draws from Philox stream r, so each run's result is the same whatever thread
+    // it lands on and however many threads there are
+    size_t runs = argc > 5 ? std::max(1, std::atoi(argv[5])) : 1;
+    unsigned threadCount = argc > 6 ? std::max(1, std::atoi(argv[6])) : std::thread::hardware_concurrency();
+    threadCount = std::max(1u, std::min<unsigned>(threadCount, static_cast<unsigned>(runs)));
+    std::vector<RunResult> results(runs);
+    std::atomic<size_t> nextRun{0};
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&] {
+            for (size_t run = nextRun++; run < runs; run = nextRun++) {
+                results[run] = simulate(flow, hawkes, seed, run, events, nullptr);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    for (size_t run = 0; run < runs; ++run) {
+        const RunResult& result = results[run];
+        if (runs > 1) std::cout << "Run " << run << ": ";
+        std::cout << "Generated " << events << " events: " << result.counts[0] << " buys, " << result.counts[1]
+                  << " sells, " << result.counts[2] << " cancels over " << static_cast<long long>(result.duration)
+                  << " time units (peak " << result.peakRate << " in one)\n";
+        std::cout << (runs > 1 ? "  " : "") << "Trades: " << result.session.count
+                  << "  Volume: " << result.session.volume << "  VWAP: " << formatPrice(result.session.vwap())
+                  << "  Resting: " << result.resting << "  Book checksum: " << std::hex << result.checksum
+                  << std::dec << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "orderbook.h"
+#include "execution.h"
+
+// Market impact harness: injects parent orders into a historical replay and compares
+// every run against the same replay without the injection.
+//   ./impact [--verify] <input_file> <experiments_file> [threads] [horizon]
+//
+// Each line of the experiments file is a parent order spec as accepted by
+// ./main --parent. The input is parsed once and shared read-only. The baseline replay
+// runs first and keeps a copy of the book at the checkpoints (every checkpointInterval
+// orders) that some experiment starts from, and only those; each injected replay forks
+// from the last checkpoint before its parent starts (everything earlier is identical to
+// the baseline) and the experiments run on a pool of threads, so thousands of pairs cost
+// little more than their own windows. --verify also replays every experiment from the
+// first order and exits with 1 if any differs from its forked run. Per experiment it reports:
+//   slippage     average fill price against the baseline price at the start, in bps
+//   temporary    mean price displacement from the baseline while the parent works, bps
+//   permanent    displacement `horizon` orders after the parent ends, bps
+//   recovery     orders after the parent ends until the price is back within a cent
+//                of the baseline (-1 if it never is within the horizon)
+// Displacements are signed so that positive means the price moved against the parent.
+
+namespace {
+
+const int checkpointInterval = 4096;
+
+struct ExperimentResult {
+    int filled = 0;
+    double averagePrice = 0.0;
+    int firstTime = 1;           // Timestamp of prices[0]
+    std::vector<double> prices;  // Last traded price after each replayed input order
+
+    double priceAt(int t) const { return prices[t - firstTime]; }
+    int lastTime() const { return firstTime + static_cast<int>(prices.size()) - 1; }
+};
+
+// Replays the orders after `book`'s checkpoint up to timestamp stopAt, with an optional
+// parent order working alongside
+ExperimentResult runReplay(OrderBook book, int checkpointTime, const std::vector<Order>& orders,
+                           const ParentOrderSpec* spec, int stopAt) {
+    ExperimentResult result;
+    result.firstTime = checkpointTime + 1;
+    std::ostream discard(nullptr);
+    std::unique_ptr<ParentOrder> parent;
+    if (spec) {
+        parent = std::make_unique<ParentOrder>(book, discard, *spec);
+        parent->start();
+    }
+    int last = std::min(stopAt, static_cast<int>(orders.size()));
+    result.prices.reserve(std::max(0, last - checkpointTime));
+    for (int i = checkpointTime; i < last; ++i) {
+        book.submit(orders[i], discard);
+        result.prices.push_back(book.getLastTradedPrice());
+    }
+    if (parent) {
+        result.filled = parent->filledQuantity();
+        result.averagePrice = parent->averagePrice();
+    }
+    return result;
+}
+
+// Whether a forked run gave the same fills and prices as the same experiment replayed
+// from the first order
+bool sameRun(const ExperimentResult& forked, const ExperimentResult& full) {
+    if (forked.filled != full.filled || forked.averagePrice != full.averagePrice ||
+        forked.lastTime() != full.lastTime()) {
+        return false;
+    }
+    for (int t = forked.firstTime; t <= forked.lastTime(); ++t) {
+        if (forked.priceAt(t) != full.priceAt(t)) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    bool verify = argc > 1 && std::string(argv[1]) == "--verify";
+    if (verify) {
+        --argc;
+        ++argv;
+    }
+    if (argc < 3 || argc > 5) {
+        std::cerr << "Usage: ./impact [--verify] <input_file> <experiments_file> [threads] [horizon]\n";
+        return 1;
+    }
+    std::ifstream inputFile(argv[1]);
+    if (!inputFile) {
+        std::cerr << "Error: Could not open file " << argv[1] << "\n";
+        return 1;
+    }
+    std::ifstream experimentsFile(argv[2]);
+    if (!experimentsFile) {
+        std::cerr << "Error: Could not open file " << argv[2] << "\n";
+        return 1;
+    }
+    unsigned threadCount = argc > 3 ? std::atoi(argv[3]) : std::thread::hardware_concurrency();
+    if (threadCount == 0) threadCount = 1;
+    int horizon = argc > 4 ? std::atoi(argv[4]) : 1000;
+
+    double initialPrice;
+    inputFile >> initialPrice;
+    inputFile.ignore();
+    std::vector<Order> orders;
+    std::string line;
+    int timestamp = 0;
+    while (std::getline(inputFile, line)) orders.push_back(parseOrder(line, ++timestamp));
+
+    std::vector<ParentOrderSpec> specs;
+    while (std::getline(experimentsFile, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        ParentOrderSpec spec;
+        if (!parseParentOrder(line, spec)) {
+            std::cerr << "Error: Invalid parent order \"" << line << "\"\n";
+            return 1;
+        }
+        specs.push_back(spec);
+    }
+
+    // The checkpoint each experiment forks from: the parent's first timer fires before
+    // order startTime is processed
+    size_t lastCheckpoint = orders.empty() ? 0 : (orders.size() - 1) / checkpointInterval;
+    auto checkpointOf = [&](const ParentOrderSpec& spec) {
+        return std::min(static_cast<size_t>(std::max(spec.startTime - 1, 0) / checkpointInterval), lastCheckpoint);
+    };
+
+    // Baseline replay, copying the book at the checkpoints some experiment needs
+    std::vector<double> baseline;
+    baseline.reserve(orders.size());
+    std::map<size_t, OrderBook> checkpoints;
+    for (const ParentOrderSpec& spec : specs) checkpoints.emplace(checkpointOf(spec), OrderBook(initialPrice));
+    {
+        OrderBook book(initialPrice);
+        book.setMutationTracking(false);
+        std::ostream discard(nullptr);
+        auto next = checkpoints.begin();
+        for (size_t i = 0; i < orders.size(); ++i) {
+            if (next != checkpoints.end() && next->first * checkpointInterval == i) (next++)->second = book;
+            book.submit(orders[i], discard);
+            baseline.push_back(book.getLastTradedPrice());
+        }
+    }
+    auto baselineAt = [&](int t) {
+        if (t < 1 || baseline.empty()) return initialPrice;
+        return baseline[std::min(static_cast<size_t>(t), baseline.size()) - 1];
+    };
+
+    // Experiments pull tasks from a shared counter
+    std::vector<ExperimentResult> results(specs.size());
+    std::vector<char> mismatched(specs.size(), 0);
+    std::atomic<size_t> nextTask{0};
+    auto worker = [&]() {
+        for (size_t task = nextTask++; task < results.size(); task = nextTask++) {
+            const ParentOrderSpec& spec = specs[task];
+            size_t index = checkpointOf(spec);
+            results[task] = runReplay(checkpoints.at(index), static_cast<int>(index) * checkpointInterval, orders,
+                                      &spec, spec.endTime + horizon);
+            if (verify) {
+                OrderBook start(initialPrice);
+                start.setMutationTracking(false);
+                ExperimentResult full = runReplay(start, 0, orders, &spec, spec.endTime + horizon);
+                mismatched[task] = !sameRun(results[task], full);
+            }
+        }
+    };
+    if (!orders.empty()) {
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < threadCount; ++i) workers.emplace_back(worker);
+        for (auto& thread : workers) thread.join();
+    }
+
+    std::cout << "parent algo side filled avg_price arrival slippage_bps temporary_bps permanent_bps recovery\n";
+    std::cout << std::fixed;
+    for (size_t i = 0; i < specs.size(); ++i) {
+        const ParentOrderSpec& spec = specs[i];
+        const ExperimentResult& run = results[i];
+        double sign = spec.type == 'B' ? 1.0 : -1.0;
+        double arrival = baselineAt(spec.startTime - 1);
+        auto bps = [&](double difference) { return arrival > 0 ? sign * difference / arrival * 1e4 : 0.0; };
+
+        double slippage = run.filled > 0 ? bps(run.averagePrice - arrival) : 0.0;
+
+        double displacement = 0.0;
+        int working = 0;
+        int lastTime = run.lastTime();
+        for (int t = std::max(spec.startTime, run.firstTime); t <= spec.endTime && t <= lastTime; ++t, ++working) {
+            displacement += run.priceAt(t) - baselineAt(t);
+        }
+        double temporary = working > 0 ? bps(displacement / working) : 0.0;
+
+        double permanent = lastTime >= run.firstTime ? bps(run.priceAt(lastTime) - baselineAt(lastTime)) : 0.0;
+
+        int recovery = -1;
+        for (int t = std::max(spec.endTime, run.firstTime); t <= lastTime; ++t) {
+            if (std::fabs(run.priceAt(t) - baselineAt(t)) < 0.0101) {
+                recovery = t - spec.endTime;
+                break;
+            }
+        }
+
+        std::cout << spec.id << " " << algoName(spec.algo) << " " << spec.type << " " << run.filled << "/"
+                  << spec.quantity << " " << formatPrice(run.averagePrice) << " " << formatPrice(arrival) << " "
+                  << std::setprecision(1) << slippage << " " << temporary << " " << permanent << " " << recovery
+                  << "\n";
+    }
+    if (verify) {
+        long long failures = 0;
+        for (size_t i = 0; i < specs.size(); ++i) {
+            if (!mismatched[i]) continue;
+            std::cerr << "Experiment " << specs[i].id << ": forked replay differs from a replay from the start\n";
+            ++failures;
+        }
+        std::cout << "Verified " << specs.size() - failures << "/" << specs.size()
+                  << " experiments against replays from the start\n";
+        if (failures > 0) return 1;
+    }
+    return 0;
+}
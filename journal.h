@@ -0,0 +1,261 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "orderbook.h"
+
+// Binary event journal plus periodic book snapshots, used to answer "what did the
+// book look like at timestamp T" without replaying the whole day.
+//
+// For a history prefix P four files are written:
+//   P.journal    every order event, length-prefixed records in timestamp order
+//   P.index      sparse journal index: (timestamp, offset) every indexInterval events
+//   P.snapshots  full resting book every snapshotInterval events (and one at timestamp 0
+//                holding the opening price)
+//   P.snapindex  (timestamp, offset) of each snapshot
+// Both index files hold fixed-size entries so they can be binary searched on disk.
+
+// Raw read/write helpers for plain values
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+inline void writeOrderRecord(std::ostream& out, const Order& order) {
+    writeValue<int32_t>(out, order.timestamp);
+    writeValue<char>(out, order.type);
+    writeValue<uint8_t>(out, order.isMarketOrder ? 1 : 0);
+    writeValue<int32_t>(out, order.quantity);
+    writeValue<double>(out, order.limitPrice);
+    writeValue<uint16_t>(out, static_cast<uint16_t>(order.id.size()));
+    out.write(order.id.data(), order.id.size());
+}
+
+inline bool readOrderRecord(std::istream& in, Order& order) {
+    int32_t timestamp, quantity;
+    uint8_t isMarket;
+    uint16_t idLength;
+    if (!readValue(in, timestamp) || !readValue(in, order.type) || !readValue(in, isMarket) ||
+        !readValue(in, quantity) || !readValue(in, order.limitPrice) || !readValue(in, idLength)) {
+        return false;
+    }
+    order.timestamp = timestamp;
+    order.quantity = quantity;
+    order.isMarketOrder = isMarket != 0;
+    order.id.resize(idLength);
+    return static_cast<bool>(in.read(&order.id[0], idLength));
+}
+
+// One fixed-size entry of either index file
+struct IndexEntry {
+    int32_t timestamp;
+    int64_t offset;
+};
+
+// Finds the last entry with timestamp <= target by binary searching the index file
+// in place. Returns false if every entry is later than target (or the file is empty).
+inline bool findIndexEntry(std::ifstream& index, int target, IndexEntry& found) {
+    const std::streamoff entrySize = sizeof(int32_t) + sizeof(int64_t);
+    index.clear();
+    index.seekg(0, std::ios::end);
+    int64_t lo = 0, hi = static_cast<int64_t>(index.tellg() / entrySize);
+    bool any = false;
+    while (lo < hi) {
+        int64_t mid = lo + (hi - lo) / 2;
+        IndexEntry entry;
+        index.seekg(mid * entrySize);
+        readValue(index, entry.timestamp);
+        readValue(index, entry.offset);
+        if (entry.timestamp <= target) {
+            found = entry;
+            any = true;
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return any;
+}
+
+// Replays an input file through an OrderBook while writing the journal, sparse index
+// and snapshots for later queries
+class HistoryWriter {
+    std::ofstream journal, index, snapshots, snapIndex;
+    int indexInterval;
+    int snapshotInterval;
+    int eventCount = 0;
+
+public:
+    HistoryWriter(const std::string& prefix, int indexEvery, int snapshotEvery)
+        : journal(prefix + ".journal", std::ios::binary),
+          index(prefix + ".index", std::ios::binary),
+          snapshots(prefix + ".snapshots", std::ios::binary),
+          snapIndex(prefix + ".snapindex", std::ios::binary),
+          indexInterval(indexEvery), snapshotInterval(snapshotEvery) {}
+
+    bool isOpen() const { return journal && index && snapshots && snapIndex; }
+
+    // Appends an event; call before the book processes it
+    void recordEvent(const Order& order) {
+        if (eventCount % indexInterval == 0) {
+            writeValue<int32_t>(index, order.timestamp);
+            writeValue<int64_t>(index, static_cast<int64_t>(journal.tellp()));
+        }
+        writeOrderRecord(journal, order);
+        ++eventCount;
+    }
+
+    // Called after the book has processed the event at timestamp
+    void afterEvent(const OrderBook& book, int timestamp) {
+        if (eventCount % snapshotInterval == 0) writeSnapshot(book, timestamp);
+    }
+
+    void writeSnapshot(const OrderBook& book, int timestamp) {
+        writeValue<int32_t>(snapIndex, timestamp);
+        writeValue<int64_t>(snapIndex, static_cast<int64_t>(snapshots.tellp()));
+
+        std::vector<Order> orders = book.restingOrders();
+        writeValue<int32_t>(snapshots, timestamp);
+        writeValue<double>(snapshots, book.getLastTradedPrice());
+        writeValue<uint32_t>(snapshots, static_cast<uint32_t>(orders.size()));
+        for (const auto& order : orders) writeOrderRecord(snapshots, order);
+    }
+};
+
+// Checksum of a list of resting orders, computed the same way as OrderBook::checksum()
+inline uint64_t restingChecksum(const std::vector<Order>& orders) {
+    uint64_t sum = 0;
+    for (const auto& order : orders) {
+        sum += orderChecksum(order.id, order.type, order.isMarketOrder ? 0.0 : order.limitPrice, order.quantity);
+    }
+    return sum;
+}
+
+// Result of replaying the journal from one snapshot up to the next one
+struct SegmentCheck {
+    int from = 0;                 // Snapshot timestamps at either end
+    int to = 0;
+    long long events = 0;         // Journal events replayed
+    bool matches = false;         // Replayed book agrees with the later snapshot
+    uint64_t expectedChecksum = 0;
+    uint64_t replayedChecksum = 0;
+    double expectedPrice = 0.0;   // Last traded prices
+    double replayedPrice = 0.0;
+};
+
+// Answers point-in-time book queries from the files written by HistoryWriter
+class HistoryReader {
+    std::ifstream journal, index, snapshots, snapIndex;
+
+public:
+    explicit HistoryReader(const std::string& prefix)
+        : journal(prefix + ".journal", std::ios::binary),
+          index(prefix + ".index", std::ios::binary),
+          snapshots(prefix + ".snapshots", std::ios::binary),
+          snapIndex(prefix + ".snapindex", std::ios::binary) {}
+
+    bool isOpen() const { return journal && index && snapshots && snapIndex; }
+
+    // Rebuilds the book as it stood after every event with timestamp <= target: loads the
+    // nearest earlier snapshot, seeks the journal just past it and replays the gap
+    OrderBook bookAt(int target) {
+        int fromTimestamp = 0;
+        OrderBook book(0.0);
+        book.setMutationTracking(false);
+
+        IndexEntry snapEntry;
+        if (findIndexEntry(snapIndex, target, snapEntry)) {
+            loadSnapshot(snapEntry.offset, book, fromTimestamp);
+        }
+        replay(book, fromTimestamp, target);
+        return book;
+    }
+
+    // Every snapshot's (timestamp, offset), in order
+    std::vector<IndexEntry> snapshotEntries() {
+        std::vector<IndexEntry> entries;
+        snapIndex.clear();
+        snapIndex.seekg(0);
+        IndexEntry entry;
+        while (readValue(snapIndex, entry.timestamp) && readValue(snapIndex, entry.offset)) entries.push_back(entry);
+        return entries;
+    }
+
+    // Replays the segment between two snapshots on a book loaded from the first and
+    // compares the result with the second (checksum of the resting orders and last
+    // traded price). Segments are independent, so they can be checked in parallel with
+    // one reader per thread.
+    SegmentCheck verifySegment(const IndexEntry& start, const IndexEntry& end) {
+        SegmentCheck check;
+        OrderBook book(0.0);
+        book.setMutationTracking(false);
+        std::vector<Order> expected;
+        if (!loadSnapshot(start.offset, book, check.from) ||
+            !readSnapshot(end.offset, check.to, check.expectedPrice, expected)) {
+            return check;
+        }
+        check.events = replay(book, check.from, check.to);
+        check.expectedChecksum = restingChecksum(expected);
+        check.replayedChecksum = book.checksum();
+        check.replayedPrice = book.getLastTradedPrice();
+        check.matches = check.expectedChecksum == check.replayedChecksum && check.expectedPrice == check.replayedPrice;
+        return check;
+    }
+
+private:
+    bool readSnapshot(int64_t offset, int& timestamp, double& lastPrice, std::vector<Order>& orders) {
+        snapshots.clear();
+        snapshots.seekg(offset);
+        int32_t storedTimestamp;
+        uint32_t count;
+        if (!readValue(snapshots, storedTimestamp) || !readValue(snapshots, lastPrice) ||
+            !readValue(snapshots, count)) {
+            return false;
+        }
+        timestamp = storedTimestamp;
+        orders.resize(count);
+        for (auto& order : orders) {
+            if (!readOrderRecord(snapshots, order)) return false;
+        }
+        return true;
+    }
+
+    bool loadSnapshot(int64_t offset, OrderBook& book, int& timestamp) {
+        double lastPrice;
+        std::vector<Order> orders;
+        if (!readSnapshot(offset, timestamp, lastPrice, orders)) return false;
+        book = OrderBook(lastPrice);
+        book.setMutationTracking(false);
+        for (const auto& order : orders) book.addOrder(order);
+        return true;
+    }
+
+    // Submits the journal events with from < timestamp <= to; returns how many
+    long long replay(OrderBook& book, int from, int to) {
+        // Jump to the closest indexed journal position, then skip what the snapshot covers
+        IndexEntry journalEntry;
+        journal.clear();
+        journal.seekg(findIndexEntry(index, from, journalEntry) ? journalEntry.offset : 0);
+
+        std::ostream discard(nullptr);
+        Order order;
+        long long events = 0;
+        while (readOrderRecord(journal, order) && order.timestamp <= to) {
+            if (order.timestamp <= from) continue;
+            book.submit(order, discard);
+            ++events;
+        }
+        return events;
+    }
+};
+
+#endif
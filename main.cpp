@@ -1,217 +1,90 @@
 #include <iostream>
+#include <cstdlib>
 #include <fstream>
-#include <sstream>
-#include <iomanip>
 #include <string>
-#include <queue>
+#include <memory>
 #include <vector>
-#include <map>
-#include <algorithm>
 
-// struct to represent an order in the order book (for all orders)
-struct Order {
-    std::string id;
-    char type; // Using similar notiation as examples given (on Blackboard) --- 'B' for buy, 'S' for sell
-    int quantity;
-    double limitPrice;
-    bool isMarketOrder;
-    int timestamp;
+#include "orderbook.h"
+#include "trade_store.h"
+#include "market_stats.h"
+#include "execution.h"
+#include "tsc_clock.h"
 
-    // Trying to use a sorting logic for a comparision operator for the priority queue of orders...
-    bool operator<(const Order& other) const {
-        if (type == 'B') { // Buy orders: Higher price first
-            if (limitPrice != other.limitPrice) return limitPrice < other.limitPrice;
-        } else { // Sell orders: Lower price first
-            if (limitPrice != other.limitPrice) return limitPrice > other.limitPrice;
-        }
-        return timestamp > other.timestamp; // Older orders first
-    }
-};
-
-// Helper function to format prices with 2 decimal places
-std::string formatPrice(double price) {
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(2) << price;
-    return oss.str();
-}
-
-// Class to manage the order book and process trades
-class OrderBook {
-    std::priority_queue<Order> buyOrders; // Priority queue for buy orders
-    std::priority_queue<Order> sellOrders; // Priority queue for sell orders
-    double lastTradedPrice; // Stores the last traded price
-
-public:
-    // Initializing the order book with the initial price (and the logic)
-    OrderBook(double initialPrice) : lastTradedPrice(initialPrice) {}
-
-    // Adds a new order to the appropriate queue
-    void addOrder(const Order& order) {
-        if (order.type == 'B') {
-            buyOrders.push(order);
-        } else {
-            sellOrders.push(order);
-        }
-    }
-
-    // Matches and executes orders from the buy and sell queues
-    void matchOrders(std::ofstream& output) {
-        while (!buyOrders.empty() && !sellOrders.empty()) {
-            Order buy = buyOrders.top();
-            Order sell = sellOrders.top();
-
-            if (!canMatch(buy, sell)) break;
-
-            buyOrders.pop();
-            sellOrders.pop();
-
-            int tradedQuantity = std::min(buy.quantity, sell.quantity);
-            double executionPrice = determinePrice(buy, sell);
-
-            lastTradedPrice = executionPrice;
-
-            // Log executed orders to the output file
-            output << "order " << buy.id << " " << tradedQuantity << " shares purchased at price "
-                   << std::fixed << std::setprecision(2) << executionPrice << "\n";
-            output << "order " << sell.id << " " << tradedQuantity << " shares sold at price "
-                   << std::fixed << std::setprecision(2) << executionPrice << "\n";
-
-            if (buy.quantity > tradedQuantity) {
-                buy.quantity -= tradedQuantity;
-                buyOrders.push(buy);
-            }
-
-            if (sell.quantity > tradedQuantity) {
-                sell.quantity -= tradedQuantity;
-                sellOrders.push(sell);
+// Main function to process orders from an input file...(and some error handling + output file)
+// By default only the changes made by each order are printed; --full brings back the
+// complete before/after book dumps. Each --parent "<spec>" works a parent order with an
+// execution algorithm alongside the input (see execution.h for the spec format).
+// --collar <band>[:rest] turns market orders into limits at the last price +- band
+// (a fraction, e.g. 0.05), cancelling what does not fill unless ":rest" is given.
+// --vol-window <orders>:<bars> sets the realized volatility bars (default 10 orders each)
+// and how many of the latest bars the estimators cover (default 30).
+// --latency times every order inside the book (not the console output) and prints
+// percentiles at the end.
+// A flight recorder (flight_recorder.h) keeps the last 64K book events and is dumped to
+// flight.rec (or --flight <file>) on a crash, SIGINT/SIGTERM/SIGUSR1, or a failed
+// invariant check: a quick one after every order, the full one every 65536 orders.
+int main(int argc, char* argv[]) {
+    bool fullDump = false;
+    bool measureLatency = false;
+    std::string inputFilename;
+    std::vector<ParentOrderSpec> parentSpecs;
+    MarketCollar collar;
+    int volBarOrders = 10;
+    int volWindowBars = 30;
+    std::string flightPath = "flight.rec";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--full") {
+            fullDump = true;
+        } else if (arg == "--latency") {
+            measureLatency = true;
+        } else if (arg == "--flight" && i + 1 < argc) {
+            flightPath = argv[++i];
+        } else if (arg == "--parent" && i + 1 < argc) {
+            ParentOrderSpec spec;
+            if (!parseParentOrder(argv[++i], spec)) {
+                std::cerr << "Error: Invalid parent order \"" << argv[i] << "\"\n";
+                return 1;
             }
-        }
-    }
-
-    void displayPendingOrders() const {
-        std::cout << "Last trading price: " << std::fixed << std::setprecision(2) << lastTradedPrice << "\n";
-        std::cout << "Buy                                    Sell\n";
-        std::cout << "-------------------------------------------------\n";
-        displayOrders(buyOrders, sellOrders);
-        std::cout << "=================================================\n";
-    }
-
-    // This writess the unexecuted orders to the output file...
-    void writeUnexecutedOrders(std::ofstream& output) const {
-        // Combine buy and sell orders into a single vector
-        std::vector<Order> unexecutedOrders;
-        // Write unexecuted buy orders
-        auto remainingBuyOrders = buyOrders;
-        while (!remainingBuyOrders.empty()) {
-            unexecutedOrders.push_back(remainingBuyOrders.top());
-            remainingBuyOrders.pop();
-        }
-        // Write unexecuted sell orders
-        auto remainingSellOrders = sellOrders;
-        while (!remainingSellOrders.empty()) {
-            unexecutedOrders.push_back(remainingSellOrders.top());
-            remainingSellOrders.pop();
-        }
-
-        std::sort(unexecutedOrders.begin(), unexecutedOrders.end(),
-                  [](const Order& a, const Order& b) { return a.timestamp < b.timestamp; });
-
-        for (const auto& order : unexecutedOrders) {
-            output << "order " << order.id << " " << order.quantity << " shares unexecuted\n";
-        }
-    }
-
-private:
-    // Determines if a buy and sell order can be matched
-    bool canMatch(const Order& buy, const Order& sell) const {
-        return (buy.isMarketOrder || sell.isMarketOrder || buy.limitPrice >= sell.limitPrice);
-    }
-
-    // Calculates the execution price for a matched pair of orders
-    double determinePrice(const Order& buy, const Order& sell) const {
-        if (!buy.isMarketOrder && !sell.isMarketOrder) {
-            return buy.timestamp < sell.timestamp ? buy.limitPrice : sell.limitPrice;
-        }
-        if (!buy.isMarketOrder) return buy.limitPrice;
-        if (!sell.isMarketOrder) return sell.limitPrice;
-        return lastTradedPrice;
-    }
-
-    // Displays buy and sell orders side by side
-    void displayOrders(const std::priority_queue<Order>& buys, const std::priority_queue<Order>& sells) const {
-        std::vector<Order> buyOrders;
-        std::vector<Order> sellOrders;
-
-        auto buyCopy = buys;
-        while (!buyCopy.empty()) {
-            buyOrders.push_back(buyCopy.top());
-            buyCopy.pop();
-        }
-
-        auto sellCopy = sells;
-        while (!sellCopy.empty()) {
-            sellOrders.push_back(sellCopy.top());
-            sellCopy.pop();
-        }
-
-        std::sort(buyOrders.begin(), buyOrders.end());
-        std::sort(sellOrders.begin(), sellOrders.end());
-
-        size_t maxRows = std::max(buyOrders.size(), sellOrders.size());
-        for (size_t i = 0; i < maxRows; ++i) {
-            if (i < buyOrders.size()) {
-                const auto& order = buyOrders[i];
-                std::cout << order.id << " "
-                          << (order.isMarketOrder ? "M" : formatPrice(order.limitPrice)) << " "
-                          << order.quantity << "\t\t";
-            } else {
-                std::cout << "\t\t\t\t";
+            parentSpecs.push_back(spec);
+        } else if (arg == "--collar" && i + 1 < argc) {
+            std::string value = argv[++i];
+            size_t colon = value.find(':');
+            collar.band = std::atof(value.substr(0, colon).c_str());
+            std::string mode = colon == std::string::npos ? "cancel" : value.substr(colon + 1);
+            if (collar.band <= 0.0 || collar.band >= 1.0 || (mode != "cancel" && mode != "rest")) {
+                std::cerr << "Error: Invalid collar \"" << value << "\"\n";
+                return 1;
             }
-
-            if (i < sellOrders.size()) {
-                const auto& order = sellOrders[i];
-                std::cout << order.id << " "
-                          << (order.isMarketOrder ? "M" : formatPrice(order.limitPrice)) << " "
-                          << order.quantity;
+            collar.residual = mode == "rest" ? CollarResidual::Rest : CollarResidual::Cancel;
+        } else if (arg == "--vol-window" && i + 1 < argc) {
+            std::string value = argv[++i];
+            size_t colon = value.find(':');
+            volBarOrders = std::atoi(value.substr(0, colon).c_str());
+            volWindowBars = colon == std::string::npos ? 0 : std::atoi(value.substr(colon + 1).c_str());
+            if (volBarOrders <= 0 || volWindowBars <= 0) {
+                std::cerr << "Error: Invalid volatility window \"" << value << "\"\n";
+                return 1;
             }
-
-            std::cout << "\n";
+        } else if (inputFilename.empty()) {
+            inputFilename = arg;
+        } else {
+            inputFilename.clear();
+            break;
         }
     }
-};
-
-// Parses an input line into an Order structure
-Order parseOrder(const std::string& line, int timestamp) {
-    std::istringstream iss(line);
-    Order order;
-    order.timestamp = timestamp;
-    std::string limitPriceStr;
-
-    iss >> order.id >> order.type >> order.quantity;
-    if (iss >> limitPriceStr) {
-        order.isMarketOrder = false;
-        order.limitPrice = std::stod(limitPriceStr);
-    } else {
-        order.isMarketOrder = true;
-        order.limitPrice = 0;
-    }
-    return order;
-}
-
-// Main function to process orders from an input file...(and some error handling + output file)
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: ./main <input_file>\n";
+    if (inputFilename.empty()) {
+        std::cerr << "Usage: ./main [--full] [--parent \"<spec>\"]... [--collar <band>[:rest]] [--vol-window <orders>:<bars>] [--latency] [--flight <file>] <input_file>\n";
         return 1;
     }
 
-    std::ifstream inputFile(argv[1]);
+    std::ifstream inputFile(inputFilename);
     if (!inputFile) {
-        std::cerr << "Error: Could not open file " << argv[1] << "\n";
+        std::cerr << "Error: Could not open file " << inputFilename << "\n";
         return 1;
     }
     // Outputing the file with same input(x) number by replcing "input" with "output"....
-    std::string inputFilename = argv[1];
     std::string outputFilename = inputFilename;
     size_t inputPos = inputFilename.find("input");
     if (inputPos != std::string::npos) {
@@ -226,28 +99,112 @@ int main(int argc, char* argv[]) {
     inputFile.ignore();
 
     OrderBook orderBook(initialPrice);
+    orderBook.setMarketCollar(collar);
+    int timestamp = 0;
+    FlightRecorder recorder;
+    orderBook.setFlightRecorder(&recorder);
+    FlightRecorder::installSignalHandlers(recorder, flightPath);
+    std::string problem;
+    auto invariantsHold = [&](bool deep) {
+        if (orderBook.checkInvariants(problem, deep)) return true;
+        std::cerr << "Error: Invariant failed after order " << timestamp << ": " << problem << "\n";
+        if (recorder.dump(flightPath.c_str(), problem.c_str())) {
+            std::cerr << "Last " << std::min<uint64_t>(recorder.recorded(), recorder.capacity())
+                      << " book events written to " << flightPath << "\n";
+        }
+        return false;
+    };
+    // Keeps every fill in memory so the tape can be queried during and after the run
+    TradeStore tape;
+    tape.attach(orderBook);
+    // Intraday risk measures: volume at price and realized volatility over the last
+    // --vol-window bars
+    VolumeProfile profile;
+    profile.attach(orderBook);
+    RealizedVolatility volatility(volBarOrders, static_cast<size_t>(volWindowBars));
+    volatility.attach(orderBook);
+    // Parent orders slice themselves into child orders on the book's timers
+    std::vector<std::unique_ptr<ParentOrder>> parents;
+    for (const auto& spec : parentSpecs) {
+        parents.push_back(std::make_unique<ParentOrder>(orderBook, outputFile, spec));
+        parents.back()->start();
+    }
 
     std::string line;
-    int timestamp = 0;
+    LatencyHistogram latency;
+    if (measureLatency) TscClock::calibrate();
 
     // Process each line in the input file
     while (std::getline(inputFile, line)) {
         ++timestamp;
          // Parse and add the new order to the orderbok
         Order order = parseOrder(line, timestamp);
+        orderBook.clearMutations();
+        uint64_t started = measureLatency ? TscClock::now() : 0;
+        // Let any timers due by now (e.g. parent order slices) run first
+        orderBook.advanceTo(timestamp);
+        if (order.type == 'C') {
+            // Cancels only take an order out of the book, there is nothing to match
+            orderBook.submit(order, outputFile);
+            if (measureLatency) latency.recordTicks(started, TscClock::nowOrdered());
+            if (!fullDump) {
+                std::cout << "\nChanges after cancel " << order.id << ":\n";
+                orderBook.displayChanges();
+            }
+            continue;
+        }
         orderBook.addOrder(order);
+        uint64_t engineTicks = measureLatency ? TscClock::nowOrdered() - started : 0;
         // Display the current state of the order book before matching...
-        std::cout << "\nBefore Matching:\n";
-        orderBook.displayPendingOrders();
+        if (fullDump) {
+            std::cout << "\nBefore Matching:\n";
+            orderBook.displayPendingOrders();
+        }
          // Match and execute the orders
+        started = measureLatency ? TscClock::now() : 0;
         orderBook.matchOrders(outputFile);
+        if (measureLatency) latency.recordTicks(engineTicks + (TscClock::nowOrdered() - started));
+        if (!invariantsHold(timestamp % 65536 == 0)) return 2;
         // Now finally display the updated state of the order book after matching...
-        std::cout << "\nAfter Matching:\n";
-        orderBook.displayPendingOrders();
+        if (fullDump) {
+            std::cout << "\nAfter Matching:\n";
+            orderBook.displayPendingOrders();
+        } else {
+            std::cout << "\nChanges after order " << order.id << ":\n";
+            orderBook.displayChanges();
+        }
     }
 
+    if (!invariantsHold(true)) return 2;
+
     std::cout << "\nFinal State of Orders:\n";
     orderBook.displayPendingOrders();
+    TradeStats session = tape.summarize();
+    std::cout << "Trades: " << session.count << "  Volume: " << session.volume
+              << "  VWAP: " << formatPrice(session.vwap()) << "\n";
+    volatility.closeBar();
+    std::cout << "Most traded price: " << formatPrice(profile.pointOfControl())
+              << " (" << profile.pointOfControlVolume() << " shares)\n";
+    std::cout << std::setprecision(4) << "Realized volatility over " << volatility.barsInWindow() << " bars:"
+              << " close-to-close " << RealizedVolatility::volatility(volatility.closeToCloseVariance())
+              << "  Parkinson " << RealizedVolatility::volatility(volatility.parkinsonVariance())
+              << "  bipower " << RealizedVolatility::volatility(volatility.bipowerVariance()) << "\n";
+    for (const auto& parent : parents) {
+        const ParentOrderSpec& spec = parent->getSpec();
+        std::cout << "Parent " << spec.id << " " << algoName(spec.algo) << ": " << parent->filledQuantity()
+                  << "/" << spec.quantity << " filled at " << formatPrice(parent->averagePrice())
+                  << " over " << parent->childCount() << " child orders\n";
+    }
+    if (measureLatency) {
+        std::cout << "Order latency (" << (TscClock::usingTsc() ? "TSC" : "steady clock") << ", "
+                  << latency.count() << " orders): p50 " << latency.percentile(50) << " ns  p99 "
+                  << latency.percentile(99) << " ns  p99.9 " << latency.percentile(99.9) << " ns  max "
+                  << latency.max() << " ns\n";
+    }
+    if (collar.band > 0.0) {
+        std::cout << "Collared market orders: " << orderBook.collaredOrderCount() << " ("
+                  << orderBook.collarCancelledQuantity() << " shares cancelled outside the band)\n";
+    }
     orderBook.writeUnexecutedOrders(outputFile);
     return 0;
 }
\ No newline at end of file
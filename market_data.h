@@ -0,0 +1,545 @@
+#ifndef MARKET_DATA_H
+#define MARKET_DATA_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "orderbook.h"
+
+// Sequenced market-data feed over UDP (multicast on loopback by default), with a TCP
+// retransmission service for gap fills.
+//
+// Every message gets the next sequence number. Messages are packed into datagrams of up
+// to maxPacketSize bytes:
+//   packet   uint64 firstSeq | uint16 count | count x (uint16 length | message)
+//   message  uint8 type | fields below
+//     OrderUpdate  int32 time | uint8 side | uint8 market | int64 priceTicks | int32 quantity | str id
+//                  (quantity is what is left resting; 0 removes the order)
+//     Trade        int32 time | int64 priceTicks | int32 quantity | str buyId | str sellId
+//     EndOfSession int32 time (no further messages follow)
+//     Checksum     int32 time | uint64 checksum (OrderBook::checksum() after every
+//                  earlier message has been applied)
+//     Indicative   int32 time | int64 priceTicks | int64 volume | int64 imbalance
+//                  (auction phase only: where the book would uncross right now)
+//   str      uint16 length | bytes
+// Integers are little-endian as on every host we run on; prices are in cents.
+//
+// Retransmission: a client connects to the TCP port and sends uint64 fromSeq | uint32
+// count. The server answers uint32 n followed by n x (uint64 seq | uint16 length |
+// message), starting at the first requested message it still holds.
+//
+// Snapshots: fromSeq 0 asks for the latest book snapshot instead. The answer has the same
+// shape; every entry carries the snapshot's sequence number S, the first is a Checksum
+// message and the rest are OrderUpdates for each resting order. Applying incrementals
+// from S + 1 on top of it reproduces the live book.
+
+enum FeedMessageType : uint8_t {
+    FeedOrderUpdate = 1,
+    FeedTrade = 2,
+    FeedEndOfSession = 3,
+    FeedChecksum = 4,
+    FeedIndicative = 5
+};
+
+struct FeedMessage {
+    uint64_t seq = 0;
+    FeedMessageType type = FeedOrderUpdate;
+    int time = 0;
+    char side = 'B';
+    bool isMarketOrder = false;
+    long long priceTicks = 0;
+    int quantity = 0;
+    std::string id;      // Order id, or buy id for trades
+    std::string otherId; // Sell id for trades
+    uint64_t checksum = 0;
+    long long volume = 0;    // Indicative matched volume
+    long long imbalance = 0; // Indicative imbalance (positive = buys)
+};
+
+// Little helpers to append/read plain values and short strings
+template <typename T>
+void appendValue(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+inline void appendString(std::string& out, const std::string& value) {
+    appendValue<uint16_t>(out, static_cast<uint16_t>(value.size()));
+    out.append(value);
+}
+
+// Bounds-checked reader over a byte range
+class ByteReader {
+    const char* pos;
+    const char* end;
+
+public:
+    ByteReader(const char* data, size_t size) : pos(data), end(data + size) {}
+
+    template <typename T>
+    bool read(T& value) {
+        if (end - pos < static_cast<std::ptrdiff_t>(sizeof(T))) return false;
+        std::memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string& value) {
+        uint16_t length;
+        if (!read(length) || end - pos < length) return false;
+        value.assign(pos, length);
+        pos += length;
+        return true;
+    }
+
+    bool readBytes(size_t length, const char*& data) {
+        if (static_cast<size_t>(end - pos) < length) return false;
+        data = pos;
+        pos += length;
+        return true;
+    }
+};
+
+inline std::string encodeOrderUpdate(const BookMutation& mutation, int time) {
+    std::string out;
+    appendValue<uint8_t>(out, FeedOrderUpdate);
+    appendValue<int32_t>(out, time);
+    appendValue<uint8_t>(out, static_cast<uint8_t>(mutation.type));
+    appendValue<uint8_t>(out, mutation.isMarketOrder ? 1 : 0);
+    appendValue<int64_t>(out, std::llround(mutation.limitPrice * 100.0));
+    appendValue<int32_t>(out, mutation.after);
+    appendString(out, mutation.id);
+    return out;
+}
+
+inline std::string encodeTrade(const Fill& fill) {
+    std::string out;
+    appendValue<uint8_t>(out, FeedTrade);
+    appendValue<int32_t>(out, fill.timestamp);
+    appendValue<int64_t>(out, std::llround(fill.price * 100.0));
+    appendValue<int32_t>(out, fill.quantity);
+    appendString(out, fill.buyId);
+    appendString(out, fill.sellId);
+    return out;
+}
+
+inline std::string encodeEndOfSession(int time) {
+    std::string out;
+    appendValue<uint8_t>(out, FeedEndOfSession);
+    appendValue<int32_t>(out, time);
+    return out;
+}
+
+inline std::string encodeChecksum(int time, uint64_t checksum) {
+    std::string out;
+    appendValue<uint8_t>(out, FeedChecksum);
+    appendValue<int32_t>(out, time);
+    appendValue<uint64_t>(out, checksum);
+    return out;
+}
+
+inline std::string encodeIndicative(const AuctionCross& cross, int time) {
+    std::string out;
+    appendValue<uint8_t>(out, FeedIndicative);
+    appendValue<int32_t>(out, time);
+    appendValue<int64_t>(out, std::llround(cross.price * 100.0));
+    appendValue<int64_t>(out, cross.volume);
+    appendValue<int64_t>(out, cross.imbalance);
+    return out;
+}
+
+inline bool decodeMessage(const char* data, size_t size, uint64_t seq, FeedMessage& message) {
+    ByteReader reader(data, size);
+    uint8_t type;
+    int32_t time;
+    if (!reader.read(type) || !reader.read(time)) return false;
+    message = FeedMessage();
+    message.seq = seq;
+    message.type = static_cast<FeedMessageType>(type);
+    message.time = time;
+    if (type == FeedOrderUpdate) {
+        uint8_t side, market;
+        int64_t ticks;
+        int32_t quantity;
+        if (!reader.read(side) || !reader.read(market) || !reader.read(ticks) || !reader.read(quantity) ||
+            !reader.readString(message.id)) {
+            return false;
+        }
+        message.side = static_cast<char>(side);
+        message.isMarketOrder = market != 0;
+        message.priceTicks = ticks;
+        message.quantity = quantity;
+        return true;
+    }
+    if (type == FeedTrade) {
+        int64_t ticks;
+        int32_t quantity;
+        if (!reader.read(ticks) || !reader.read(quantity) || !reader.readString(message.id) ||
+            !reader.readString(message.otherId)) {
+            return false;
+        }
+        message.priceTicks = ticks;
+        message.quantity = quantity;
+        return true;
+    }
+    if (type == FeedChecksum) return reader.read(message.checksum);
+    if (type == FeedIndicative) {
+        int64_t ticks, volume, imbalance;
+        if (!reader.read(ticks) || !reader.read(volume) || !reader.read(imbalance)) return false;
+        message.priceTicks = ticks;
+        message.volume = volume;
+        message.imbalance = imbalance;
+        return true;
+    }
+    return type == FeedEndOfSession;
+}
+
+// Splits a datagram into its messages; returns false if it is malformed
+inline bool decodePacket(const char* data, size_t size, std::vector<FeedMessage>& messages) {
+    ByteReader reader(data, size);
+    uint64_t seq;
+    uint16_t count;
+    if (!reader.read(seq) || !reader.read(count)) return false;
+    messages.clear();
+    for (uint16_t i = 0; i < count; ++i, ++seq) {
+        uint16_t length;
+        const char* body;
+        FeedMessage message;
+        if (!reader.read(length) || !reader.readBytes(length, body) || !decodeMessage(body, length, seq, message)) {
+            return false;
+        }
+        messages.push_back(std::move(message));
+    }
+    return true;
+}
+
+// Reads exactly size bytes from a stream socket
+inline bool readFully(int fd, void* data, size_t size) {
+    char* out = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t got = ::recv(fd, out, size, 0);
+        if (got <= 0) return false;
+        out += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+inline bool writeFully(int fd, const void* data, size_t size) {
+    const char* in = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t sent = ::send(fd, in, size, MSG_NOSIGNAL);
+        if (sent <= 0) return false;
+        in += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+inline sockaddr_in loopbackAddress(uint16_t port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return address;
+}
+
+// Asks the retransmission service on localhost:port for messages [fromSeq, fromSeq+count).
+// Messages the publisher no longer holds are simply missing from the answer.
+// fromSeq 0 requests a snapshot instead (see above).
+inline bool requestRetransmission(uint16_t port, uint64_t fromSeq, uint32_t count, std::vector<FeedMessage>& messages) {
+    messages.clear();
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    sockaddr_in address = loopbackAddress(port);
+    bool ok = ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 &&
+              writeFully(fd, &fromSeq, sizeof(fromSeq)) && writeFully(fd, &count, sizeof(count));
+    uint32_t answered = 0;
+    ok = ok && readFully(fd, &answered, sizeof(answered));
+    for (uint32_t i = 0; ok && i < answered; ++i) {
+        uint64_t seq;
+        uint16_t length;
+        ok = readFully(fd, &seq, sizeof(seq)) && readFully(fd, &length, sizeof(length));
+        std::string body(length, '\0');
+        ok = ok && readFully(fd, &body[0], length);
+        FeedMessage message;
+        ok = ok && decodeMessage(body.data(), body.size(), seq, message);
+        if (ok) messages.push_back(std::move(message));
+    }
+    ::close(fd);
+    return ok;
+}
+
+// Opens a UDP socket receiving the feed on port; joins group on the loopback interface
+// if it is a multicast address
+inline int openFeedReceiver(const std::string& group, uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+    int reuse = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    int bufferSize = 16 << 20;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    in_addr groupAddress{};
+    if (::inet_pton(AF_INET, group.c_str(), &groupAddress) == 1 && IN_MULTICAST(ntohl(groupAddress.s_addr))) {
+        ip_mreq membership{};
+        membership.imr_multiaddr = groupAddress;
+        membership.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+        if (::setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+struct FeedConfig {
+    std::string group = "239.255.0.1";  // Multicast group, or a unicast address such as 127.0.0.1
+    uint16_t port = 30001;
+    uint16_t retransmitPort = 30002;
+    size_t maxPacketSize = 1400;        // Fits a standard Ethernet MTU
+    size_t retainMessages = 1 << 20;    // How far back gaps can be filled
+    int dropEvery = 0;                  // Testing aid: silently skip every Nth datagram
+    int indicativeInterval = 10;        // Simulated time between indicative auction updates
+    int retransmitTimeoutMs = 1000;     // A gap-fill client stalled this long is dropped
+};
+
+// Publishes book changes and trades as sequenced datagrams and keeps the most recent
+// messages for the TCP retransmission service, which runs on its own thread
+class FeedPublisher {
+    FeedConfig config;
+    int udpSocket = -1;
+    int listenSocket = -1;
+    sockaddr_in destination{};
+    std::thread retransmitThread;
+    std::atomic<bool> stopping{false};
+    std::mutex clientMutex;  // Guards activeClient, so close() never shuts down a reused fd
+    int activeClient = -1;   // Gap-fill connection being served, if any
+
+    std::string packet;      // Datagram being filled
+    uint16_t packetCount = 0;
+    uint64_t packetFirstSeq = 1;
+    uint64_t packetsSent = 0;
+
+    std::mutex historyMutex; // Guards nextSeq and the history against the retransmit thread
+    uint64_t nextSeq = 1;
+    std::vector<std::string> history; // Ring of encoded messages, indexed by seq % size
+    uint64_t historyFirstSeq = 1;
+
+    std::mutex snapshotMutex; // Guards the latest snapshot
+    uint64_t snapshotSeq = 0;
+    std::vector<std::string> snapshot; // Checksum message, then one OrderUpdate per order
+
+    IndicativeThrottle indicativeThrottle;
+
+public:
+    explicit FeedPublisher(const FeedConfig& feedConfig)
+        : config(feedConfig), history(feedConfig.retainMessages), indicativeThrottle(feedConfig.indicativeInterval) {}
+
+    ~FeedPublisher() { close(); }
+
+    FeedPublisher(const FeedPublisher&) = delete;
+    FeedPublisher& operator=(const FeedPublisher&) = delete;
+
+    // Opens the UDP socket and starts the retransmission service
+    bool open() {
+        udpSocket = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (udpSocket < 0) return false;
+        destination.sin_family = AF_INET;
+        destination.sin_port = htons(config.port);
+        if (::inet_pton(AF_INET, config.group.c_str(), &destination.sin_addr) != 1) return false;
+        if (IN_MULTICAST(ntohl(destination.sin_addr.s_addr))) {
+            in_addr loopback{};
+            loopback.s_addr = htonl(INADDR_LOOPBACK);
+            unsigned char loop = 1, ttl = 0;
+            ::setsockopt(udpSocket, IPPROTO_IP, IP_MULTICAST_IF, &loopback, sizeof(loopback));
+            ::setsockopt(udpSocket, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+            ::setsockopt(udpSocket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+        }
+        int bufferSize = 16 << 20;
+        ::setsockopt(udpSocket, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+
+        listenSocket = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listenSocket < 0) return false;
+        int reuse = 1;
+        ::setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address = loopbackAddress(config.retransmitPort);
+        if (::bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(listenSocket, 16) != 0) {
+            return false;
+        }
+        retransmitThread = std::thread([this] { serveRetransmissions(); });
+        return true;
+    }
+
+    // Publishes every trade as it happens
+    void attach(OrderBook& book) {
+        book.addFillListener([this](const Fill& fill) { publish(encodeTrade(fill)); });
+    }
+
+    // Publishes the order changes the book recorded since its last clearMutations()
+    // and clears them
+    void publishChanges(OrderBook& book) {
+        for (const auto& mutation : book.recentMutations()) publish(encodeOrderUpdate(mutation, book.getCurrentTime()));
+        book.clearMutations();
+    }
+
+    void publish(const std::string& message) {
+        uint64_t seq;
+        {
+            std::lock_guard<std::mutex> lock(historyMutex);
+            seq = nextSeq++;
+            history[seq % history.size()] = message;
+            if (seq - historyFirstSeq >= history.size()) historyFirstSeq = seq - history.size() + 1;
+        }
+        size_t needed = sizeof(uint16_t) + message.size();
+        if (packetCount > 0 && headerSize() + packet.size() + needed > config.maxPacketSize) flush();
+        if (packetCount == 0) packetFirstSeq = seq;
+        appendValue<uint16_t>(packet, static_cast<uint16_t>(message.size()));
+        packet.append(message);
+        ++packetCount;
+    }
+
+    // Sends the datagram being built, if any
+    void flush() {
+        if (packetCount == 0) return;
+        std::string datagram;
+        datagram.reserve(headerSize() + packet.size());
+        appendValue<uint64_t>(datagram, packetFirstSeq);
+        appendValue<uint16_t>(datagram, packetCount);
+        datagram.append(packet);
+        ++packetsSent;
+        if (config.dropEvery <= 0 || packetsSent % config.dropEvery != 0) {
+            ::sendto(udpSocket, datagram.data(), datagram.size(), 0, reinterpret_cast<sockaddr*>(&destination),
+                     sizeof(destination));
+        }
+        packet.clear();
+        packetCount = 0;
+    }
+
+    // Publishes the book checksum so replicas can verify themselves
+    void publishChecksum(const OrderBook& book) {
+        publish(encodeChecksum(book.getCurrentTime(), book.checksum()));
+    }
+
+    // During an auction phase, publishes the indicative cross if it changed, at most once
+    // per indicativeInterval of simulated time
+    void publishIndicative(const OrderBook& book) {
+        if (!book.inAuction() || !indicativeThrottle.due(book.getCurrentTime())) return;
+        AuctionCross cross = book.indicativeCross();
+        if (indicativeThrottle.offer(cross, book.getCurrentTime())) publish(encodeIndicative(cross, book.getCurrentTime()));
+    }
+
+    // Keeps a copy of the book, as of the last published message, for late joiners
+    void storeSnapshot(const OrderBook& book) {
+        std::vector<std::string> messages;
+        messages.push_back(encodeChecksum(book.getCurrentTime(), book.checksum()));
+        for (const auto& order : book.restingOrders()) {
+            BookMutation state{order.id, order.type, order.limitPrice, order.isMarketOrder, 0, order.quantity};
+            messages.push_back(encodeOrderUpdate(state, order.timestamp));
+        }
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        snapshotSeq = nextSeq - 1;
+        snapshot.swap(messages);
+    }
+
+    // Publishes the end-of-session marker and flushes
+    void endSession(int time) {
+        publish(encodeEndOfSession(time));
+        flush();
+    }
+
+    void close() {
+        if (retransmitThread.joinable()) {
+            stopping = true;
+            ::shutdown(listenSocket, SHUT_RDWR);
+            {
+                // Shutting down the listener does not wake a read on an accepted socket
+                std::lock_guard<std::mutex> lock(clientMutex);
+                if (activeClient >= 0) ::shutdown(activeClient, SHUT_RDWR);
+            }
+            retransmitThread.join();
+        }
+        if (listenSocket >= 0) ::close(listenSocket);
+        if (udpSocket >= 0) ::close(udpSocket);
+        listenSocket = udpSocket = -1;
+    }
+
+    uint64_t messagesPublished() const { return nextSeq - 1; }
+    uint64_t datagramsSent() const { return packetsSent; }
+
+private:
+    static size_t headerSize() { return sizeof(uint64_t) + sizeof(uint16_t); }
+
+    // One client at a time; each gets retransmitTimeoutMs per read or write, so one that
+    // connects and goes quiet holds up the other gap fills and close() only that long
+    void serveRetransmissions() {
+        timeval timeout{};
+        timeout.tv_sec = config.retransmitTimeoutMs / 1000;
+        timeout.tv_usec = (config.retransmitTimeoutMs % 1000) * 1000;
+        while (!stopping) {
+            int client = ::accept(listenSocket, nullptr, nullptr);
+            if (client < 0) continue;
+            ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            {
+                std::lock_guard<std::mutex> lock(clientMutex);
+                if (stopping) ::shutdown(client, SHUT_RDWR);  // close() has been and gone
+                activeClient = client;
+            }
+            uint64_t fromSeq;
+            uint32_t count;
+            if (readFully(client, &fromSeq, sizeof(fromSeq)) && readFully(client, &count, sizeof(count))) {
+                std::string reply;
+                uint32_t answered = 0;
+                appendValue<uint32_t>(reply, 0);
+                if (fromSeq == 0) {
+                    std::lock_guard<std::mutex> lock(snapshotMutex);
+                    for (const auto& message : snapshot) {
+                        appendValue<uint64_t>(reply, snapshotSeq);
+                        appendValue<uint16_t>(reply, static_cast<uint16_t>(message.size()));
+                        reply.append(message);
+                        ++answered;
+                    }
+                } else {
+                    std::lock_guard<std::mutex> lock(historyMutex);
+                    uint64_t first = std::max(fromSeq, historyFirstSeq);
+                    uint64_t last = std::min<uint64_t>(fromSeq + count, nextSeq);
+                    for (uint64_t seq = first; seq < last; ++seq, ++answered) {
+                        const std::string& message = history[seq % history.size()];
+                        appendValue<uint64_t>(reply, seq);
+                        appendValue<uint16_t>(reply, static_cast<uint16_t>(message.size()));
+                        reply.append(message);
+                    }
+                }
+                std::memcpy(&reply[0], &answered, sizeof(answered));
+                writeFully(client, reply.data(), reply.size());
+            }
+            {
+                std::lock_guard<std::mutex> lock(clientMutex);
+                activeClient = -1;
+            }
+            ::close(client);
+        }
+    }
+};
+
+#endif
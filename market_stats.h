@@ -0,0 +1,167 @@
+#ifndef MARKET_STATS_H
+#define MARKET_STATS_H
+
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+#include "orderbook.h"
+
+// Streaming statistics fed from fills while the book runs. Everything here updates in
+// O(1) amortized per fill so it can stay attached during long replays.
+
+// Prices are keyed on whole cents, matching the two decimal places the book prints
+inline long long priceTicks(double price) {
+    return std::llround(price * 100.0);
+}
+
+// Volume traded at each price since the start of the session
+class VolumeProfile {
+    std::unordered_map<long long, long long> volumeAtTick;
+    long long pocTick = 0;    // Point of control: the price with the most volume so far
+    long long pocVolume = 0;
+    long long total = 0;
+
+public:
+    void attach(OrderBook& book) {
+        book.addFillListener([this](const Fill& fill) { add(fill.price, fill.quantity); });
+    }
+
+    void add(double price, int quantity) {
+        long long tick = priceTicks(price);
+        long long& volume = volumeAtTick[tick];
+        volume += quantity;
+        total += quantity;
+        // Volumes only grow, so the leader can be kept without rescanning
+        if (volume > pocVolume) {
+            pocVolume = volume;
+            pocTick = tick;
+        }
+    }
+
+    long long volumeAt(double price) const {
+        auto it = volumeAtTick.find(priceTicks(price));
+        return it == volumeAtTick.end() ? 0 : it->second;
+    }
+
+    long long totalVolume() const { return total; }
+    double pointOfControl() const { return pocTick / 100.0; }
+    long long pointOfControlVolume() const { return pocVolume; }
+};
+
+// Fixed-capacity ring of the latest values with a running sum. A plain sum -= old,
+// sum += new drifts: once a large value has left, the total can sit below zero. The sum
+// is therefore compensated (Neumaier), which keeps the rounding error to that of the
+// values currently in the window.
+class RollingWindow {
+    std::vector<double> values;
+    size_t next = 0;
+    size_t count = 0;
+    double sum = 0.0;
+    double compensation = 0.0;  // Low-order bits lost from sum
+
+public:
+    explicit RollingWindow(size_t capacity) : values(capacity > 0 ? capacity : 1, 0.0) {}
+
+    void push(double value) {
+        if (count == values.size()) {
+            add(-values[next]);
+        } else {
+            ++count;
+        }
+        values[next] = value;
+        add(value);
+        next = (next + 1) % values.size();
+    }
+
+    size_t size() const { return count; }
+    bool full() const { return count == values.size(); }
+    double total() const { return sum + compensation; }
+
+private:
+    void add(double value) {
+        double updated = sum + value;
+        if (std::fabs(sum) >= std::fabs(value)) {
+            compensation += (sum - updated) + value;
+        } else {
+            compensation += (value - updated) + sum;
+        }
+        sum = updated;
+    }
+};
+
+// Rolling realized volatility over the last `windowBars` bars, where a bar covers
+// `barInterval` units of order time. Three estimators are kept side by side:
+//   close-to-close  sum of squared log returns between bar closes
+//   Parkinson       (1 / 4 ln 2) * sum of squared log(high / low) per bar
+//   bipower         (pi / 2) * sum of |r_i| * |r_i-1|, robust to single jumps
+// All three are reported as realized variance over the window; volatility() takes the
+// square root. Bars with no trades are skipped rather than counted as zero returns.
+class RealizedVolatility {
+    int barInterval;
+    RollingWindow squaredReturns;
+    RollingWindow squaredRanges;
+    RollingWindow returnProducts;
+
+    bool barOpen = false;
+    long long barIndex = 0;
+    double barHigh = 0.0, barLow = 0.0, barClose = 0.0;
+
+    bool haveClose = false;     // A previous bar close exists to compute a return from
+    double previousClose = 0.0;
+    bool haveReturn = false;    // A previous return exists for the bipower product
+    double previousAbsReturn = 0.0;
+
+public:
+    RealizedVolatility(int barLength, size_t windowBars)
+        : barInterval(barLength > 0 ? barLength : 1),
+          squaredReturns(windowBars), squaredRanges(windowBars), returnProducts(windowBars) {}
+
+    void attach(OrderBook& book) {
+        book.addFillListener([this](const Fill& fill) { addTrade(fill.timestamp, fill.price); });
+    }
+
+    void addTrade(int timestamp, double price) {
+        long long index = timestamp / barInterval;
+        if (barOpen && index != barIndex) closeBar();
+        if (!barOpen) {
+            barOpen = true;
+            barIndex = index;
+            barHigh = barLow = price;
+        }
+        barHigh = std::max(barHigh, price);
+        barLow = std::min(barLow, price);
+        barClose = price;
+    }
+
+    // Folds the bar in progress into the windows (otherwise it is folded in by the
+    // first trade of a later bar)
+    void closeBar() {
+        if (!barOpen) return;
+        barOpen = false;
+
+        if (barLow > 0.0) {
+            double range = std::log(barHigh / barLow);
+            squaredRanges.push(range * range / (4.0 * std::log(2.0)));
+        }
+        if (haveClose && previousClose > 0.0 && barClose > 0.0) {
+            double r = std::log(barClose / previousClose);
+            squaredReturns.push(r * r);
+            if (haveReturn) returnProducts.push(std::fabs(r) * previousAbsReturn * std::acos(-1.0) / 2.0);
+            previousAbsReturn = std::fabs(r);
+            haveReturn = true;
+        }
+        previousClose = barClose;
+        haveClose = true;
+    }
+
+    double closeToCloseVariance() const { return squaredReturns.total(); }
+    double parkinsonVariance() const { return squaredRanges.total(); }
+    double bipowerVariance() const { return returnProducts.total(); }
+
+    static double volatility(double variance) { return std::sqrt(std::max(variance, 0.0)); }
+
+    size_t barsInWindow() const { return squaredRanges.size(); }
+};
+
+#endif
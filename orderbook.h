@@ -0,0 +1,916 @@
+#ifndef ORDERBOOK_H
+#define ORDERBOOK_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <queue>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "auction.h"
+#include "flight_recorder.h"
+
+// struct to represent an order in the order book (for all orders)
+// A line "<orderID> C" cancels the resting order with that id; it is parsed into an
+// Order with type 'C' and no quantity.
+struct Order {
+    std::string id;
+    char type; // Using similar notiation as examples given (on Blackboard) --- 'B' for buy, 'S' for sell
+    int quantity;
+    double limitPrice;
+    bool isMarketOrder;
+    int timestamp;
+
+    // Trying to use a sorting logic for a comparision operator for the priority queue of orders...
+    bool operator<(const Order& other) const {
+        if (type == 'B') { // Buy orders: Higher price first
+            if (limitPrice != other.limitPrice) return limitPrice < other.limitPrice;
+        } else { // Sell orders: Lower price first
+            if (limitPrice != other.limitPrice) return limitPrice > other.limitPrice;
+        }
+        return timestamp > other.timestamp; // Older orders first
+    }
+};
+
+// One change to a resting order, recorded by the order book so the console can show
+// just what moved instead of re-printing everything. before == 0 means the order was
+// added, after == 0 means it left the book (fully filled or cancelled).
+struct BookMutation {
+    std::string id;
+    char type;
+    double limitPrice;
+    bool isMarketOrder;
+    int before;
+    int after;
+};
+
+// One execution between a buy and a sell, reported to fill listeners as it happens.
+// timestamp is the arrival time of the order that triggered the match.
+struct Fill {
+    std::string buyId;
+    std::string sellId;
+    int quantity;
+    double price;
+    int timestamp;
+};
+
+// Price collar for market orders: with a band, a market order is turned into a limit
+// order at lastTradedPrice * (1 +- band) (rounded outward to the cent), so it can only
+// sweep the levels inside the band. Whatever is left after matching is cancelled, or
+// rests at the collar price. band 0 leaves market orders alone.
+enum class CollarResidual { Cancel, Rest };
+
+struct MarketCollar {
+    double band = 0.0;
+    CollarResidual residual = CollarResidual::Cancel;
+};
+
+// A callback the book runs once simulated time reaches `when`. seq keeps timers due at
+// the same time in the order they were scheduled.
+struct Timer {
+    int when;
+    long long seq;
+    std::function<void()> callback;
+
+    bool operator<(const Timer& other) const { // Earliest first in a priority_queue
+        if (when != other.when) return when > other.when;
+        return seq > other.seq;
+    }
+};
+
+// Hash of one resting order's visible state. The book checksum is the sum of these over
+// all resting orders, so it can be kept up to date incrementally and recomputed the
+// same way by anyone holding a copy of the book (e.g. a market-data replica).
+inline uint64_t orderChecksum(const std::string& id, char type, double limitPrice, int quantity) {
+    uint64_t hash = 1469598103934665603ULL; // FNV-1a over the id
+    for (unsigned char c : id) hash = (hash ^ c) * 1099511628211ULL;
+    hash ^= static_cast<uint64_t>(std::llround(limitPrice * 100.0)) * 0x9E3779B97F4A7C15ULL;
+    hash ^= (static_cast<uint64_t>(static_cast<unsigned char>(type)) << 32) ^ static_cast<uint32_t>(quantity);
+    // splitmix64 finaliser so nearby states land far apart
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EBULL;
+    return hash ^ (hash >> 31);
+}
+
+// Helper function to format prices with 2 decimal places
+inline std::string formatPrice(double price) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2) << price;
+    return oss.str();
+}
+
+// Class to manage the order book and process trades
+class OrderBook {
+    std::priority_queue<Order> buyOrders; // Priority queue for buy orders
+    std::priority_queue<Order> sellOrders; // Priority queue for sell orders
+    double lastTradedPrice; // Stores the last traded price
+    std::vector<BookMutation> mutations; // Changes since the last clearMutations()
+    double mutationStartPrice; // Last traded price when the mutations were cleared
+    bool trackMutations = true; // Replays that never display changes can switch recording off
+    int currentTime = 0; // Latest order timestamp seen, stamped on fills
+    std::vector<std::function<void(const Fill&)>> fillListeners; // Called for every execution
+    std::unordered_map<std::string, Order> openOrders; // Live orders by id, with remaining quantity
+    uint64_t bookChecksum = 0; // Sum of orderChecksum() over openOrders
+    std::unordered_set<std::string> cancelledIds; // Cancelled orders still sitting in a queue
+    std::priority_queue<Timer> timers; // Pending timers, earliest first
+    long long timerSeq = 0;
+    bool firingTimers = false; // Timers may submit orders, which must not re-enter advanceTo
+    bool auctionPhase = false; // Orders rest without matching until uncross()
+    AuctionDepth auctionDepth; // Depth curves of the resting orders, during the auction phase
+    std::map<long long, long long, std::greater<long long>> bidDepth; // Limit quantity per price tick, best first
+    std::map<long long, long long> askDepth;
+    uint64_t topChanges = 0; // Bumped whenever the best bid or ask level changes
+    MarketCollar collar;
+    std::string collarPending; // Collared order to cancel once it has matched
+    long long collaredOrders = 0;
+    long long collarCancelledShares = 0;
+    FlightRecorder* recorder = nullptr; // Optional ring of recent events (flight_recorder.h)
+    long long passiveBatchOrders = 0; // Orders submitBatch() sent down the insert-only path
+
+public:
+    // Initializing the order book with the initial price (and the logic)
+    OrderBook(double initialPrice) : lastTradedPrice(initialPrice), mutationStartPrice(initialPrice) {}
+
+    // Adds a new order to the appropriate queue
+    void addOrder(const Order& order) {
+        if (order.isMarketOrder && collar.band > 0.0 && !auctionPhase) {
+            addOrder(collared(order));
+            return;
+        }
+        currentTime = std::max(currentTime, order.timestamp);
+        if (recorder) {
+            recorder->order(currentTime, order.id, order.type, order.isMarketOrder, order.limitPrice, order.quantity);
+        }
+        recordMutation(order, 0, order.quantity);
+        Order& open = openOrders[order.id];
+        if (!open.id.empty()) {
+            bookChecksum -= checksumOf(open);
+            adjustDepth(open, -open.quantity);
+            if (auctionPhase) trackDepth(open, -1);
+        }
+        open = order;
+        bookChecksum += checksumOf(order);
+        adjustDepth(order, order.quantity);
+        if (auctionPhase) trackDepth(order, 1);
+        if (order.type == 'B') {
+            buyOrders.push(order);
+        } else {
+            sellOrders.push(order);
+        }
+    }
+
+    // Cancels a resting order by id; returns false if it is not in the book (already
+    // filled, cancelled or never seen). The queue entry itself is skipped lazily.
+    bool cancelOrder(const std::string& id) {
+        auto it = openOrders.find(id);
+        if (it == openOrders.end()) return false;
+        if (recorder) recorder->cancel(currentTime, id, it->second.type);
+        recordMutation(it->second, it->second.quantity, 0);
+        bookChecksum -= checksumOf(it->second);
+        adjustDepth(it->second, -it->second.quantity);
+        if (auctionPhase) trackDepth(it->second, -1);
+        cancelledIds.insert(id);
+        openOrders.erase(it);
+        return true;
+    }
+
+    // Runs `callback` when simulated time reaches `when` (at the latest just before the
+    // first order stamped `when` or later is processed)
+    void scheduleTimer(int when, std::function<void()> callback) {
+        timers.push({when, timerSeq++, std::move(callback)});
+    }
+
+    // Moves the clock to `time`, firing every timer due by then in time order. Timers
+    // scheduled while firing run in the same pass if they are already due.
+    void advanceTo(int time) {
+        if (firingTimers) return;
+        firingTimers = true;
+        while (!timers.empty() && timers.top().when <= time) {
+            Timer timer = timers.top();
+            timers.pop();
+            currentTime = std::max(currentTime, timer.when);
+            timer.callback();
+        }
+        currentTime = std::max(currentTime, time);
+        firingTimers = false;
+    }
+
+    // Processes one parsed input line: cancels it, or adds it and matches (during an
+    // auction phase it only rests)
+    void submit(const Order& order, std::ostream& output) {
+        advanceTo(order.timestamp);
+        if (order.type == 'C') {
+            cancelOrder(order.id);
+            return;
+        }
+        addOrder(order);
+        if (!auctionPhase) matchOrders(output);
+    }
+
+    // Same result as submit() on each order in turn, faster when most orders do not cross.
+    // Orders are classified in blocks of batchLanes. For each one the best bid it can
+    // possibly meet is bounded by the current top and the buy limits ahead of it in the
+    // block (unbounded after a market buy), and likewise the best ask. Cancels and fills
+    // only take limit liquidity away, so a limit order on the right side of that bound
+    // cannot match: it is only inserted, as long as a resting market order cannot have
+    // surfaced on the other side (frontIsBoundedLimit()). The rest go through submit().
+    // The bounds still hold after a trade, only looser, so the block is classified again
+    // when the next order it could not clear comes up.
+    // The classification is a branch-free max over fixed-size arrays, which the compiler
+    // vectorizes. Runs of passive orders also skip most of the cancelled-top lookups
+    // matchOrders() repeats for every order: once both tops are known to be live only a
+    // new top, or a cancel of a top, needs checking again.
+    // Whole blocks fall back to submit() during an auction, while timers are pending, or
+    // when a top of book is a cancelled entry not yet dropped. Fill listeners must not
+    // submit to this book.
+    void submitBatch(const Order* orders, size_t count, std::ostream& output) {
+        alignas(64) double buyPrices[batchLanes];
+        alignas(64) double sellPrices[batchLanes];
+        alignas(64) double bidBounds[batchLanes];
+        alignas(64) double askBounds[batchLanes];
+        alignas(64) double slack[batchLanes];
+        bool topsLive = false; // Neither top is a cancelled entry, so dropCancelledTops() has nothing to do
+        for (size_t first = 0; first < count;) {
+            const Order* block = orders + first;
+            size_t inBlock = std::min(batchLanes, count - first);
+            double bidBound, askBound;
+            bool fastPath = !auctionPhase && timers.empty() && peekTopPrice(buyOrders, unbounded, topsLive, bidBound) &&
+                            peekTopPrice(sellOrders, -unbounded, topsLive, askBound) && bidBound < askBound;
+            if (!fastPath) {
+                for (size_t i = 0; i < inBlock; ++i) submit(block[i], output);
+                first += inBlock;
+                topsLive = false;
+                continue;
+            }
+            // Lanes that are not limit orders never come out positive
+            for (size_t i = 0; i < batchLanes; ++i) {
+                buyPrices[i] = unbounded;
+                sellPrices[i] = -unbounded;
+                bidBounds[i] = bidBound;
+                askBounds[i] = askBound;
+                if (i >= inBlock) continue;
+                const Order& order = block[i];
+                if (order.type == 'B') {
+                    if (order.isMarketOrder) {
+                        bidBound = unbounded;
+                    } else {
+                        buyPrices[i] = order.limitPrice;
+                        bidBound = std::max(bidBound, order.limitPrice);
+                    }
+                } else if (order.type == 'S') {
+                    if (order.isMarketOrder) {
+                        askBound = -unbounded;
+                    } else {
+                        sellPrices[i] = order.limitPrice;
+                        askBound = std::min(askBound, order.limitPrice);
+                    }
+                }
+            }
+            classifyBlock(buyPrices, sellPrices, bidBounds, askBounds, slack);
+            size_t i = 0;
+            bool stale = false;  // Orders have gone through submit() since the block was classified
+            while (i < inBlock) {
+                const Order& order = block[i];
+                // A timer may submit anywhere in the book, so the bounds would not hold
+                if (auctionPhase || !timers.empty()) break;
+                if (slack[i] > 0.0 && frontIsBoundedLimit(order.type == 'B' ? 'S' : 'B')) {
+                    advanceTo(order.timestamp);
+                    addOrder(order);
+                    // What matchOrders() would do before finding no match
+                    if (!topsLive || (isTopEntry(order) && !cancelledIds.empty() && cancelledIds.count(order.id))) {
+                        dropCancelledTops();
+                        topsLive = !buyOrders.empty() && !sellOrders.empty();
+                    }
+                    ++passiveBatchOrders;
+                    ++i;
+                    continue;
+                }
+                // The bounds still hold after a trade, just looser than they could be:
+                // classify the rest against the new tops before sending an order on
+                if (stale && order.type != 'C') break;
+                submit(order, output);
+                ++i;
+                if (order.type == 'C') {
+                    topsLive = topsLive && !isTopId(buyOrders, order.id) && !isTopId(sellOrders, order.id);
+                } else {
+                    // matchOrders() stops on two live tops unless a side ran out, but a
+                    // collared market order's remainder is cancelled after that
+                    topsLive = !auctionPhase && !buyOrders.empty() && !sellOrders.empty() &&
+                               !(order.isMarketOrder && collar.band > 0.0);
+                    stale = true;
+                }
+            }
+            first += i;
+        }
+    }
+
+    long long passiveBatchCount() const { return passiveBatchOrders; }
+
+    // Starts collecting orders for an auction (e.g. before the open)
+    void startAuction() {
+        auctionPhase = true;
+        auctionDepth.clear();
+        for (const auto& entry : openOrders) trackDepth(entry.second, 1);
+    }
+
+    bool inAuction() const { return auctionPhase; }
+
+    // The price the book would uncross at right now: the limit price that executes the
+    // most volume, then leaves the smallest imbalance, then is closest to the last
+    // traded price. Market orders count at every price; with no limit orders at all the
+    // cross happens at the last traded price. volume is 0 if nothing would trade.
+    // During an auction phase this comes from depth curves kept up to date on every
+    // arrival and cancel (see AuctionDepth), so it is cheap enough to ask after each order.
+    AuctionCross indicativeCross() const {
+        if (auctionPhase && auctionDepth.dense()) return auctionDepth.cross(lastTradedPrice);
+        std::map<double, std::pair<long long, long long>> levels; // Limit price -> buy and sell quantity
+        long long marketBuys = 0, marketSells = 0;
+        for (const auto& entry : openOrders) {
+            const Order& order = entry.second;
+            if (order.isMarketOrder) {
+                (order.type == 'B' ? marketBuys : marketSells) += order.quantity;
+            } else if (order.type == 'B') {
+                levels[order.limitPrice].first += order.quantity;
+            } else {
+                levels[order.limitPrice].second += order.quantity;
+            }
+        }
+        AuctionCross best{lastTradedPrice, std::min(marketBuys, marketSells), marketBuys - marketSells};
+        if (levels.empty()) return best;
+
+        // Buys at or above each price, accumulated from the top
+        std::vector<long long> buysAbove(levels.size());
+        long long running = marketBuys;
+        size_t index = levels.size();
+        for (auto it = levels.rbegin(); it != levels.rend(); ++it) {
+            running += it->second.first;
+            buysAbove[--index] = running;
+        }
+        long long sellsBelow = marketSells;
+        bool found = false;
+        index = 0;
+        for (const auto& level : levels) {
+            sellsBelow += level.second.second;
+            long long buys = buysAbove[index++];
+            AuctionCross candidate{level.first, std::min(buys, sellsBelow), buys - sellsBelow};
+            if (!found || betterCross(candidate, best, lastTradedPrice)) {
+                best = candidate;
+                found = true;
+            }
+        }
+        return best;
+    }
+
+    // Ends the auction phase: executes the indicative cross with every fill at the one
+    // auction price (market orders first, then price, then time on each side), then
+    // resumes continuous matching. Returns the cross that was executed.
+    AuctionCross uncross(std::ostream& output) {
+        AuctionCross cross = indicativeCross();
+        auctionPhase = false;
+        auctionDepth.clear();
+        if (cross.volume > 0) {
+            std::vector<Order> buys = liveOrders(buyOrders);
+            std::vector<Order> sells = liveOrders(sellOrders);
+            buyOrders = {};
+            sellOrders = {};
+            cancelledIds.clear(); // Their queue entries are gone too
+            auto auctionPriority = [](const Order& a, const Order& b) {
+                if (a.isMarketOrder != b.isMarketOrder) return a.isMarketOrder;
+                if (a.limitPrice != b.limitPrice) {
+                    return a.type == 'B' ? a.limitPrice > b.limitPrice : a.limitPrice < b.limitPrice;
+                }
+                return a.timestamp < b.timestamp;
+            };
+            std::stable_sort(buys.begin(), buys.end(), auctionPriority);
+            std::stable_sort(sells.begin(), sells.end(), auctionPriority);
+
+            // The first `volume` shares on each side are all willing to trade at the price
+            long long left = cross.volume;
+            size_t b = 0, s = 0;
+            while (left > 0) {
+                Order& buy = buys[b];
+                Order& sell = sells[s];
+                int tradedQuantity = static_cast<int>(std::min<long long>({buy.quantity, sell.quantity, left}));
+                recordFill(buy, sell, tradedQuantity, cross.price, output);
+                buy.quantity -= tradedQuantity;
+                sell.quantity -= tradedQuantity;
+                left -= tradedQuantity;
+                if (buy.quantity == 0) ++b;
+                if (sell.quantity == 0) ++s;
+            }
+            for (const auto& order : buys) {
+                if (order.quantity > 0) buyOrders.push(order);
+            }
+            for (const auto& order : sells) {
+                if (order.quantity > 0) sellOrders.push(order);
+            }
+        }
+        matchOrders(output);
+        return cross;
+    }
+
+    // Matches and executes orders from the buy and sell queues
+    void matchOrders(std::ostream& output) {
+        while (!buyOrders.empty() && !sellOrders.empty()) {
+            if (dropCancelledTop(buyOrders) || dropCancelledTop(sellOrders)) continue;
+
+            Order buy = buyOrders.top();
+            Order sell = sellOrders.top();
+
+            if (!canMatch(buy, sell)) break;
+
+            buyOrders.pop();
+            sellOrders.pop();
+
+            int tradedQuantity = std::min(buy.quantity, sell.quantity);
+            double executionPrice = determinePrice(buy, sell);
+            recordFill(buy, sell, tradedQuantity, executionPrice, output);
+
+            if (buy.quantity > tradedQuantity) {
+                buy.quantity -= tradedQuantity;
+                buyOrders.push(buy);
+            }
+
+            if (sell.quantity > tradedQuantity) {
+                sell.quantity -= tradedQuantity;
+                sellOrders.push(sell);
+            }
+        }
+        if (!collarPending.empty()) {
+            auto it = openOrders.find(collarPending);
+            if (it != openOrders.end()) {
+                collarCancelledShares += it->second.quantity;
+                cancelOrder(collarPending);
+            }
+            collarPending.clear();
+        }
+    }
+
+    void displayPendingOrders() const {
+        std::cout << "Last trading price: " << std::fixed << std::setprecision(2) << lastTradedPrice << "\n";
+        std::cout << "Buy                                    Sell\n";
+        std::cout << "-------------------------------------------------\n";
+        displayOrders(buyOrders, sellOrders);
+        std::cout << "=================================================\n";
+    }
+
+    // Forgets the recorded changes, so the next diff starts from the current state
+    void clearMutations() {
+        mutations.clear();
+        mutationStartPrice = lastTradedPrice;
+    }
+
+    const std::vector<BookMutation>& recentMutations() const { return mutations; }
+
+    void setMutationTracking(bool enabled) {
+        trackMutations = enabled;
+        mutations.clear();
+    }
+
+    double getLastTradedPrice() const { return lastTradedPrice; }
+
+    void setMarketCollar(const MarketCollar& marketCollar) { collar = marketCollar; }
+    long long collaredOrderCount() const { return collaredOrders; }
+    long long collarCancelledQuantity() const { return collarCancelledShares; }
+    int getCurrentTime() const { return currentTime; }
+
+    // Registers a callback run for every execution, in the order trades happen
+    void addFillListener(std::function<void(const Fill&)> listener) {
+        fillListeners.push_back(std::move(listener));
+    }
+
+    // All resting orders, buys then sells, each side in priority order
+    std::vector<Order> restingOrders() const {
+        std::vector<Order> orders = liveOrders(buyOrders);
+        std::vector<Order> sells = liveOrders(sellOrders);
+        orders.insert(orders.end(), sells.begin(), sells.end());
+        return orders;
+    }
+
+    bool isResting(const std::string& id) const { return openOrders.count(id) > 0; }
+    size_t openOrderCount() const { return openOrders.size(); }
+
+    // Checksum of all resting orders (ids, sides, prices and remaining quantities)
+    uint64_t checksum() const { return bookChecksum; }
+
+    // Records every order, cancel, fill and top-of-book change into `flightRecorder`
+    // (nullptr stops). The recorder must outlive the book or be detached first.
+    void setFlightRecorder(FlightRecorder* flightRecorder) { recorder = flightRecorder; }
+
+    // Consistency checks for long production runs; false with `problem` set if one fails.
+    // The quick one (best bid below best ask outside an auction, after matching) is O(1)
+    // and fine after every order. deep also recomputes the checksum and both depth maps
+    // from the open orders, which is O(book).
+    bool checkInvariants(std::string& problem, bool deep = false) const {
+        if (!auctionPhase && !bidDepth.empty() && !askDepth.empty() &&
+            bidDepth.begin()->first >= askDepth.begin()->first) {
+            problem = "crossed book: bid " + formatPrice(bidDepth.begin()->first / 100.0) + " >= ask " +
+                      formatPrice(askDepth.begin()->first / 100.0);
+            return false;
+        }
+        if (!deep) return true;
+        uint64_t sum = 0;
+        std::map<long long, long long, std::greater<long long>> bids;
+        std::map<long long, long long> asks;
+        for (const auto& entry : openOrders) {
+            const Order& order = entry.second;
+            if (order.quantity <= 0) {
+                problem = "open order " + entry.first + " has no quantity left";
+                return false;
+            }
+            sum += checksumOf(order);
+            if (order.isMarketOrder) continue;
+            long long ticks = std::llround(order.limitPrice * 100.0);
+            if (order.type == 'B') {
+                bids[ticks] += order.quantity;
+            } else {
+                asks[ticks] += order.quantity;
+            }
+        }
+        if (sum != bookChecksum) {
+            problem = "book checksum does not match the open orders";
+            return false;
+        }
+        if (bids != bidDepth || asks != askDepth) {
+            problem = "depth levels do not match the open orders";
+            return false;
+        }
+        return true;
+    }
+
+    // Best limit level on each side as price in ticks (cents) and total quantity;
+    // false if that side has no limit orders. Resting market orders are not counted.
+    bool bestBid(long long& ticks, long long& quantity) const { return bestLevel(bidDepth, ticks, quantity); }
+    bool bestAsk(long long& ticks, long long& quantity) const { return bestLevel(askDepth, ticks, quantity); }
+
+    // Changes whenever the best bid or ask level (price or quantity) does, so anything
+    // derived from the top of the book knows when to look again
+    uint64_t topVersion() const { return topChanges; }
+
+    // The order at the front of a side's queue (nullptr if the side is empty)
+    const Order* topOrder(char side) {
+        std::priority_queue<Order>& queue = side == 'B' ? buyOrders : sellOrders;
+        while (dropCancelledTop(queue)) continue;
+        return queue.empty() ? nullptr : &queue.top();
+    }
+
+    // Fills the order at the front of `side` against a counterparty outside this book
+    // (e.g. the other legs of an implied spread trade)
+    void fillTop(char side, int quantity, double price, const std::string& counterparty, std::ostream& output) {
+        std::priority_queue<Order>& queue = side == 'B' ? buyOrders : sellOrders;
+        while (dropCancelledTop(queue)) continue;
+        if (queue.empty()) return;
+        Order top = queue.top();
+        queue.pop();
+        quantity = std::min(quantity, top.quantity);
+        recordMutation(top, top.quantity, top.quantity - quantity);
+        bookExternalFill(top, quantity, price, counterparty, output);
+        updateOpenQuantity(top.id, top.quantity - quantity);
+        if (top.quantity > quantity) {
+            top.quantity -= quantity;
+            queue.push(top);
+        }
+    }
+
+    // Books a fill for an incoming order that traded outside this book's queues (it
+    // never rests here)
+    void fillIncoming(const Order& order, int quantity, double price, const std::string& counterparty,
+                      std::ostream& output) {
+        currentTime = std::max(currentTime, order.timestamp);
+        bookExternalFill(order, quantity, price, counterparty, output);
+    }
+
+    // Prints only the orders and price levels that changed since clearMutations(),
+    // so the cost is proportional to what the last order touched rather than book size
+    void displayChanges() const {
+        // Merge repeated changes to the same order (e.g. several partial fills) into one,
+        // keeping first-touched order; indexed by id and side so a sweep stays linear
+        std::vector<BookMutation> orders;
+        std::unordered_map<std::string, size_t> merged;
+        for (const auto& m : mutations) {
+            auto inserted = merged.emplace(m.id + m.type, orders.size());
+            if (inserted.second) {
+                orders.push_back(m);
+            } else {
+                orders[inserted.first->second].after = m.after;
+            }
+        }
+
+        // Net quantity change per (side, price) level
+        std::map<std::pair<char, double>, int> levels;
+        for (const auto& o : orders) {
+            levels[{o.type, o.isMarketOrder ? -1.0 : o.limitPrice}] += o.after - o.before;
+        }
+
+        std::cout << "Last trading price: " << formatPrice(mutationStartPrice);
+        if (lastTradedPrice != mutationStartPrice) std::cout << " -> " << formatPrice(lastTradedPrice);
+        std::cout << "\n";
+        std::cout << "-------------------------------------------------\n";
+        for (const auto& level : levels) {
+            if (level.second == 0) continue;
+            std::cout << "Level " << level.first.first << " "
+                      << (level.first.second < 0 ? "M" : formatPrice(level.first.second)) << " "
+                      << (level.second > 0 ? "+" : "") << level.second << "\n";
+        }
+        for (const auto& o : orders) {
+            std::cout << "Order " << o.id << " " << o.type << " "
+                      << (o.isMarketOrder ? "M" : formatPrice(o.limitPrice)) << " "
+                      << o.before << " -> " << o.after;
+            if (o.before == 0 && o.after > 0) std::cout << " (new)";
+            else if (o.after == 0) std::cout << " (done)";
+            std::cout << "\n";
+        }
+        std::cout << "=================================================\n";
+    }
+
+    // This writess the unexecuted orders to the output file...
+    void writeUnexecutedOrders(std::ostream& output) const {
+        // Combine buy and sell orders into a single vector
+        std::vector<Order> unexecutedOrders = restingOrders();
+
+        std::sort(unexecutedOrders.begin(), unexecutedOrders.end(),
+                  [](const Order& a, const Order& b) { return a.timestamp < b.timestamp; });
+
+        for (const auto& order : unexecutedOrders) {
+            output << "order " << order.id << " " << order.quantity << " shares unexecuted\n";
+        }
+    }
+
+private:
+    static constexpr size_t batchLanes = 16;
+    // Stands in for "no bound" in submitBatch(); finite so differences never give NaN
+    static constexpr double unbounded = 1e18;
+
+    // One block of submitBatch(): how far each lane is from crossing. A lane that is not a
+    // limit buy holds unbounded in buyPrices and one that is not a limit sell -unbounded in
+    // sellPrices, so only its own side can make it positive; slack[i] > 0 means it cannot cross.
+    static void classifyBlock(const double* __restrict buyPrices, const double* __restrict sellPrices,
+                              const double* __restrict bidBounds, const double* __restrict askBounds,
+                              double* __restrict slack) {
+        for (size_t i = 0; i < batchLanes; ++i) {
+            slack[i] = std::max(askBounds[i] - buyPrices[i], sellPrices[i] - bidBounds[i]);
+        }
+    }
+
+    // The price matchOrders() would see at the front of a queue (`market` for a market
+    // order, -market if the side is empty); false if that entry is cancelled (unless
+    // known not to be)
+    bool peekTopPrice(const std::priority_queue<Order>& queue, double market, bool knownLive, double& price) const {
+        if (queue.empty()) {
+            price = -market;
+            return true;
+        }
+        const Order& top = queue.top();
+        if (!knownLive && !cancelledIds.empty() && cancelledIds.count(top.id)) return false;
+        price = top.isMarketOrder ? market : top.limitPrice;
+        return true;
+    }
+
+    static bool isTopId(const std::priority_queue<Order>& queue, const std::string& id) {
+        return !queue.empty() && queue.top().id == id;
+    }
+
+    // Whether the entry just queued for `order` is at the front of its side
+    bool isTopEntry(const Order& order) const {
+        const Order& top = (order.type == 'B' ? buyOrders : sellOrders).top();
+        return top.timestamp == order.timestamp && top.id == order.id;
+    }
+
+    // Whether the front of `side` is still a limit price no better than what submitBatch()
+    // has bounded it by. A market order carries limitPrice 0, so the sides differ:
+    //   bids  a market buy ranks below every limit bid and only surfaces once no open limit
+    //         bid is left above it, which a cancel or fill mid-block can bring about. The
+    //         front is bounded while bidDepth has a level, or nothing is queued at all.
+    //   asks  a market sell ranks above every limit ask, so a resting one is already the
+    //         front: peekTopPrice() reports it as -unbounded and the block never takes the
+    //         fast path. One that arrives mid-block sets askBound to -unbounded for every
+    //         later lane. The same depth test only turns away asks holding nothing but
+    //         cancelled or market entries, which is merely conservative.
+    bool frontIsBoundedLimit(char side) const {
+        return side == 'B' ? !bidDepth.empty() || buyOrders.empty() : !askDepth.empty() || sellOrders.empty();
+    }
+
+    // The cancelled entries matchOrders() drops from the tops before it compares them
+    void dropCancelledTops() {
+        while (!buyOrders.empty() && !sellOrders.empty() &&
+               (dropCancelledTop(buyOrders) || dropCancelledTop(sellOrders))) {
+        }
+    }
+
+    // Pops the top of a queue if it was cancelled; returns whether it did
+    bool dropCancelledTop(std::priority_queue<Order>& queue) {
+        if (cancelledIds.empty() || queue.empty()) return false;
+        auto it = cancelledIds.find(queue.top().id);
+        if (it == cancelledIds.end()) return false;
+        cancelledIds.erase(it);
+        queue.pop();
+        return true;
+    }
+
+    // Books one execution: price, recorded changes, listeners, the output log and the
+    // open quantities. buy and sell still carry their quantities from before the fill.
+    void recordFill(const Order& buy, const Order& sell, int tradedQuantity, double executionPrice,
+                    std::ostream& output) {
+        lastTradedPrice = executionPrice;
+        if (recorder) recorder->fill(currentTime, buy.id, sell.id, tradedQuantity, executionPrice);
+        recordMutation(buy, buy.quantity, buy.quantity - tradedQuantity);
+        recordMutation(sell, sell.quantity, sell.quantity - tradedQuantity);
+        if (!fillListeners.empty()) {
+            Fill fill{buy.id, sell.id, tradedQuantity, executionPrice, currentTime};
+            for (const auto& listener : fillListeners) listener(fill);
+        }
+
+        // Log executed orders to the output file
+        output << "order " << buy.id << " " << tradedQuantity << " shares purchased at price "
+               << std::fixed << std::setprecision(2) << executionPrice << "\n";
+        output << "order " << sell.id << " " << tradedQuantity << " shares sold at price "
+               << std::fixed << std::setprecision(2) << executionPrice << "\n";
+
+        updateOpenQuantity(buy.id, buy.quantity - tradedQuantity);
+        updateOpenQuantity(sell.id, sell.quantity - tradedQuantity);
+    }
+
+    template <typename Depth>
+    static bool bestLevel(const Depth& depth, long long& ticks, long long& quantity) {
+        if (depth.empty()) return false;
+        ticks = depth.begin()->first;
+        quantity = depth.begin()->second;
+        return true;
+    }
+
+    // Moves a limit order's quantity at its price level by `delta`
+    void adjustDepth(const Order& order, long long delta) {
+        if (order.isMarketOrder || delta == 0) return;
+        long long ticks = std::llround(order.limitPrice * 100.0);
+        uint64_t topBefore = topChanges;
+        if (order.type == 'B') {
+            if (bidDepth.empty() || ticks >= bidDepth.begin()->first) ++topChanges;
+            if ((bidDepth[ticks] += delta) <= 0) bidDepth.erase(ticks);
+        } else {
+            if (askDepth.empty() || ticks <= askDepth.begin()->first) ++topChanges;
+            if ((askDepth[ticks] += delta) <= 0) askDepth.erase(ticks);
+        }
+        if (recorder && topChanges != topBefore) {
+            long long bidTicks = -1, bidQuantity = 0, askTicks = -1, askQuantity = 0;
+            bestLevel(bidDepth, bidTicks, bidQuantity);
+            bestLevel(askDepth, askTicks, askQuantity);
+            recorder->top(currentTime, bidTicks, bidQuantity, askTicks, askQuantity);
+        }
+    }
+
+    // Price, listeners and the output line for one side of a fill whose other side is
+    // not in this book
+    void bookExternalFill(const Order& order, int quantity, double price, const std::string& counterparty,
+                          std::ostream& output) {
+        lastTradedPrice = price;
+        if (recorder) {
+            if (order.type == 'B') {
+                recorder->fill(currentTime, order.id, counterparty, quantity, price);
+            } else {
+                recorder->fill(currentTime, counterparty, order.id, quantity, price);
+            }
+        }
+        if (!fillListeners.empty()) {
+            Fill fill = order.type == 'B' ? Fill{order.id, counterparty, quantity, price, currentTime}
+                                          : Fill{counterparty, order.id, quantity, price, currentTime};
+            for (const auto& listener : fillListeners) listener(fill);
+        }
+        output << "order " << order.id << " " << quantity << " shares "
+               << (order.type == 'B' ? "purchased" : "sold") << " at price " << std::fixed << std::setprecision(2)
+               << price << "\n";
+    }
+
+    void trackDepth(const Order& order, int sign) {
+        auctionDepth.update(order.type, order.isMarketOrder, order.limitPrice, order.quantity, sign);
+    }
+
+    void updateOpenQuantity(const std::string& id, int remaining) {
+        auto it = openOrders.find(id);
+        if (it == openOrders.end()) return;
+        bookChecksum -= checksumOf(it->second);
+        adjustDepth(it->second, remaining - it->second.quantity);
+        if (remaining > 0) {
+            it->second.quantity = remaining;
+            bookChecksum += checksumOf(it->second);
+        } else {
+            openOrders.erase(it);
+        }
+    }
+
+    static uint64_t checksumOf(const Order& order) {
+        return orderChecksum(order.id, order.type, order.isMarketOrder ? 0.0 : order.limitPrice, order.quantity);
+    }
+
+    // Copies a queue's orders out in priority order, leaving out cancelled ones
+    std::vector<Order> liveOrders(const std::priority_queue<Order>& queue) const {
+        std::vector<Order> orders;
+        orders.reserve(queue.size());
+        auto copy = queue;
+        while (!copy.empty()) {
+            if (!cancelledIds.count(copy.top().id)) orders.push_back(copy.top());
+            copy.pop();
+        }
+        return orders;
+    }
+
+    void recordMutation(const Order& order, int before, int after) {
+        if (!trackMutations) return;
+        mutations.push_back({order.id, order.type, order.limitPrice, order.isMarketOrder, before, after});
+    }
+
+    // Determines if a buy and sell order can be matched
+    bool canMatch(const Order& buy, const Order& sell) const {
+        return (buy.isMarketOrder || sell.isMarketOrder || buy.limitPrice >= sell.limitPrice);
+    }
+
+    // The limit order a market order becomes under the collar
+    Order collared(const Order& order) {
+        Order limited = order;
+        limited.isMarketOrder = false;
+        double bound = lastTradedPrice * (order.type == 'B' ? 1.0 + collar.band : 1.0 - collar.band) * 100.0;
+        // Outward to a whole cent; the small slack keeps exact cents from being bumped
+        bound = order.type == 'B' ? std::ceil(bound - 1e-6) : std::floor(bound + 1e-6);
+        limited.limitPrice = std::max(1.0, bound) / 100.0;
+        ++collaredOrders;
+        if (collar.residual == CollarResidual::Cancel) collarPending = order.id;
+        return limited;
+    }
+
+    // Calculates the execution price for a matched pair of orders
+    double determinePrice(const Order& buy, const Order& sell) const {
+        if (!buy.isMarketOrder && !sell.isMarketOrder) {
+            return buy.timestamp < sell.timestamp ? buy.limitPrice : sell.limitPrice;
+        }
+        if (!buy.isMarketOrder) return buy.limitPrice;
+        if (!sell.isMarketOrder) return sell.limitPrice;
+        return lastTradedPrice;
+    }
+
+    // Displays buy and sell orders side by side
+    void displayOrders(const std::priority_queue<Order>& buys, const std::priority_queue<Order>& sells) const {
+        std::vector<Order> buyOrders = liveOrders(buys);
+        std::vector<Order> sellOrders = liveOrders(sells);
+
+        std::sort(buyOrders.begin(), buyOrders.end());
+        std::sort(sellOrders.begin(), sellOrders.end());
+
+        size_t maxRows = std::max(buyOrders.size(), sellOrders.size());
+        for (size_t i = 0; i < maxRows; ++i) {
+            if (i < buyOrders.size()) {
+                const auto& order = buyOrders[i];
+                std::cout << order.id << " "
+                          << (order.isMarketOrder ? "M" : formatPrice(order.limitPrice)) << " "
+                          << order.quantity << "\t\t";
+            } else {
+                std::cout << "\t\t\t\t";
+            }
+
+            if (i < sellOrders.size()) {
+                const auto& order = sellOrders[i];
+                std::cout << order.id << " "
+                          << (order.isMarketOrder ? "M" : formatPrice(order.limitPrice)) << " "
+                          << order.quantity;
+            }
+
+            std::cout << "\n";
+        }
+    }
+};
+
+// Parses an input line into an Order structure
+inline Order parseOrder(const std::string& line, int timestamp) {
+    std::istringstream iss(line);
+    Order order;
+    order.timestamp = timestamp;
+    std::string limitPriceStr;
+
+    iss >> order.id >> order.type;
+    if (order.type == 'C') {
+        order.quantity = 0;
+        order.isMarketOrder = false;
+        order.limitPrice = 0;
+        return order;
+    }
+    iss >> order.quantity;
+    if (iss >> limitPriceStr) {
+        order.isMarketOrder = false;
+        order.limitPrice = std::stod(limitPriceStr);
+    } else {
+        order.isMarketOrder = true;
+        order.limitPrice = 0;
+    }
+    return order;
+}
+
+#endif
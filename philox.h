@@ -0,0 +1,85 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+// Counter-based random numbers (Philox4x32-10, Salmon et al., "Parallel random numbers:
+// as easy as 1, 2, 3"). Each output block is a pure function of a 128-bit counter and a
+// 64-bit key: ten rounds of multiply/xor scramble the counter under the key. Nothing is
+// carried from one draw to the next, so any (key, counter) can be computed on any thread
+// in any order and always gives the same bits.
+//
+// A PhiloxStream fixes the key to the run's seed and the counter's upper half to a stream
+// id (an agent, a symbol, a run), and counts draws in the lower half. Streams with
+// different ids never overlap, and a simulation whose entities each draw from their own
+// stream gives bit-identical results however the entities are spread across threads.
+
+inline std::array<uint32_t, 4> philox4x32(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key) {
+    for (int round = 0; round < 10; ++round) {
+        if (round > 0) {
+            key[0] += 0x9E3779B9u;  // Weyl sequence key schedule
+            key[1] += 0xBB67AE85u;
+        }
+        uint64_t product0 = static_cast<uint64_t>(0xD2511F53u) * counter[0];
+        uint64_t product1 = static_cast<uint64_t>(0xCD9E8D57u) * counter[2];
+        counter = {static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0], static_cast<uint32_t>(product1),
+                   static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1], static_cast<uint32_t>(product0)};
+    }
+    return counter;
+}
+
+// Stream id for a name (FNV-1a), so entities can be keyed by their ids
+inline uint64_t streamIdOf(const std::string& name) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : name) hash = (hash ^ c) * 1099511628211ULL;
+    return hash;
+}
+
+// One independent stream of 64-bit values. Meets UniformRandomBitGenerator, but prefer
+// uniform() over the std distributions, whose algorithms differ between standard libraries.
+class PhiloxStream {
+    uint64_t seed;
+    uint64_t stream;
+    uint64_t block = 0;   // Next counter value to encrypt
+    uint64_t buffer[2] = {0, 0};
+    int buffered = 0;     // Values of buffer[] not yet handed out (taken from the back)
+
+public:
+    using result_type = uint64_t;
+
+    explicit PhiloxStream(uint64_t seedValue = 0, uint64_t streamId = 0) : seed(seedValue), stream(streamId) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()() {
+        if (buffered == 0) {
+            std::array<uint32_t, 4> out = philox4x32(
+                {static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32), static_cast<uint32_t>(stream),
+                 static_cast<uint32_t>(stream >> 32)},
+                {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)});
+            buffer[1] = (static_cast<uint64_t>(out[1]) << 32) | out[0];
+            buffer[0] = (static_cast<uint64_t>(out[3]) << 32) | out[2];
+            buffered = 2;
+            ++block;
+        }
+        return buffer[--buffered];
+    }
+
+    // Uniform double in [0, 1) from the top 53 bits
+    double uniform() { return static_cast<double>((*this)() >> 11) * 0x1.0p-53; }
+
+    // Jumps to the n-th value of the stream (0 = the first) in O(1)
+    void seek(uint64_t n) {
+        block = n / 2;
+        buffered = 0;
+        if (n % 2 == 1) (*this)();
+    }
+
+    uint64_t streamId() const { return stream; }
+};
+
+#endif
@@ -0,0 +1,365 @@
+#ifndef SHARD_LINK_H
+#define SHARD_LINK_H
+
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "orderbook.h"
+#include "market_data.h"
+
+// Symbol shards as separate processes. A shard owns a set of books and serves one
+// coordinator over TCP; the coordinator routes each order to the shard holding its
+// symbol and collects the fills and final book states. Everything on a link is a frame:
+//   frame    uint32 length | uint8 type | payload (length covers type and payload)
+// Coordinator to shard:
+//   Assign   uint8 auction | uint32 n | n x (str symbol | double initial price)
+//            (books are numbered 0..n-1 in this order; auction puts them in their
+//            opening auction phase)
+//   Orders   uint32 n | n x (uint32 book | int32 time | uint8 type | uint8 market |
+//            double limit price | int32 quantity | str id)
+//   Open     (uncross every book still in its auction phase)
+//   Finish   (send Results and end the session)
+// Shard to coordinator:
+//   Fills    uint32 n | n x (uint32 book | str buyId | str sellId | int32 quantity | double price)
+//   Ack      uint32 orders (processed since the last Ack; returns flow-control credit)
+//   Opened   int64 volume
+//   Results  uint32 n | n x (int64 processed | double last price | uint64 open orders |
+//            uint64 checksum)
+// Prices travel as doubles so a shard's books see exactly the values a local run would.
+// Orders go out in batches, and a coordinator never has more than its window of orders
+// un-acked on a link, which also bounds how much fill traffic can pile up on the way back.
+
+enum LinkFrameType : uint8_t {
+    LinkAssign = 1,
+    LinkOrders = 2,
+    LinkOpen = 3,
+    LinkFinish = 4,
+    LinkFills = 5,
+    LinkAck = 6,
+    LinkOpened = 7,
+    LinkResults = 8
+};
+
+// Starts a frame in `out`; finishFrame() fills in its length once the payload is appended
+inline size_t beginFrame(std::string& out, LinkFrameType type) {
+    size_t start = out.size();
+    appendValue<uint32_t>(out, 0);
+    appendValue<uint8_t>(out, type);
+    return start;
+}
+
+inline void finishFrame(std::string& out, size_t start) {
+    uint32_t length = static_cast<uint32_t>(out.size() - start - sizeof(uint32_t));
+    std::memcpy(&out[start], &length, sizeof(length));
+}
+
+// Reads one frame; false when the link is closed or broken
+inline bool readFrame(int fd, uint8_t& type, std::string& payload) {
+    uint32_t length;
+    if (!readFully(fd, &length, sizeof(length)) || length == 0 || !readFully(fd, &type, sizeof(type))) return false;
+    payload.resize(length - 1);
+    return length == 1 || readFully(fd, &payload[0], payload.size());
+}
+
+inline void tuneLink(int fd) {
+    int noDelay = 1;  // Frames are already batched
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    int bufferSize = 4 << 20;
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+}
+
+// Listening socket on port (0 picks a free one) on all interfaces, or loopback only
+inline int listenOn(uint16_t port, bool loopbackOnly) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int reuse = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address = loopbackAddress(port);
+    if (!loopbackOnly) address.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 4) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+inline uint16_t boundPort(int fd) {
+    sockaddr_in address{};
+    socklen_t size = sizeof(address);
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &size);
+    return ntohs(address.sin_port);
+}
+
+// Connects to "host:port"; -1 on failure
+inline int connectTo(const std::string& endpoint) {
+    size_t colon = endpoint.rfind(':');
+    if (colon == std::string::npos) return -1;
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (::getaddrinfo(endpoint.substr(0, colon).c_str(), endpoint.substr(colon + 1).c_str(), &hints, &found) != 0) {
+        return -1;
+    }
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd >= 0 && ::connect(fd, found->ai_addr, found->ai_addrlen) != 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    ::freeaddrinfo(found);
+    if (fd >= 0) tuneLink(fd);
+    return fd;
+}
+
+// Shard side: accepts one coordinator on a listening socket and runs its session
+class ShardServer {
+    struct Book {
+        std::unique_ptr<OrderBook> book;
+        long long processed = 0;
+    };
+
+    std::vector<Book> books;
+    std::string fills;  // Fills frame being built
+    size_t fillsStart = 0;
+    uint32_t fillCount = 0;
+    int fd = -1;
+
+public:
+    long long ordersRun = 0;
+
+    // Serves one session; false if the link broke before Finish
+    bool serve(int listenSocket) {
+        fd = ::accept(listenSocket, nullptr, nullptr);
+        if (fd < 0) return false;
+        tuneLink(fd);
+        uint8_t type;
+        std::string payload;
+        bool finished = false;
+        std::ostream discard(nullptr);
+        while (!finished && readFrame(fd, type, payload)) {
+            ByteReader reader(payload.data(), payload.size());
+            std::string reply;
+            if (type == LinkAssign) {
+                if (!assign(reader)) break;
+            } else if (type == LinkOrders) {
+                uint32_t count = 0;
+                if (!reader.read(count)) break;
+                startFills();
+                for (uint32_t i = 0; i < count; ++i) {
+                    uint32_t index;
+                    Order order;
+                    uint8_t side, market;
+                    if (!reader.read(index) || index >= books.size() || !reader.read(order.timestamp) ||
+                        !reader.read(side) || !reader.read(market) || !reader.read(order.limitPrice) ||
+                        !reader.read(order.quantity) || !reader.readString(order.id)) {
+                        ::close(fd);
+                        return false;
+                    }
+                    order.type = static_cast<char>(side);
+                    order.isMarketOrder = market != 0;
+                    books[index].book->submit(order, discard);
+                    ++books[index].processed;
+                }
+                ordersRun += count;
+                takeFills(reply);
+                size_t start = beginFrame(reply, LinkAck);
+                appendValue<uint32_t>(reply, count);
+                finishFrame(reply, start);
+            } else if (type == LinkOpen) {
+                startFills();
+                long long volume = 0;
+                for (auto& entry : books) {
+                    if (entry.book->inAuction()) volume += entry.book->uncross(discard).volume;
+                }
+                takeFills(reply);
+                size_t start = beginFrame(reply, LinkOpened);
+                appendValue<int64_t>(reply, volume);
+                finishFrame(reply, start);
+            } else if (type == LinkFinish) {
+                size_t start = beginFrame(reply, LinkResults);
+                appendValue<uint32_t>(reply, static_cast<uint32_t>(books.size()));
+                for (const auto& entry : books) {
+                    appendValue<int64_t>(reply, entry.processed);
+                    appendValue<double>(reply, entry.book->getLastTradedPrice());
+                    appendValue<uint64_t>(reply, entry.book->openOrderCount());
+                    appendValue<uint64_t>(reply, entry.book->checksum());
+                }
+                finishFrame(reply, start);
+                finished = true;
+            }
+            if (!reply.empty() && !writeFully(fd, reply.data(), reply.size())) break;
+        }
+        ::close(fd);
+        fd = -1;
+        return finished;
+    }
+
+private:
+    bool assign(ByteReader& reader) {
+        uint8_t auction;
+        uint32_t count;
+        if (!reader.read(auction) || !reader.read(count)) return false;
+        books.clear();
+        for (uint32_t i = 0; i < count; ++i) {
+            std::string symbol;
+            double initialPrice;
+            if (!reader.readString(symbol) || !reader.read(initialPrice)) return false;
+            books.push_back(Book{std::make_unique<OrderBook>(initialPrice), 0});
+            if (auction) books.back().book->startAuction();
+            uint32_t index = i;
+            books.back().book->addFillListener([this, index](const Fill& fill) { addFill(index, fill); });
+        }
+        return true;
+    }
+
+    void startFills() {
+        fills.clear();
+        fillsStart = beginFrame(fills, LinkFills);
+        appendValue<uint32_t>(fills, 0);
+        fillCount = 0;
+    }
+
+    void addFill(uint32_t index, const Fill& fill) {
+        appendValue<uint32_t>(fills, index);
+        appendString(fills, fill.buyId);
+        appendString(fills, fill.sellId);
+        appendValue<int32_t>(fills, fill.quantity);
+        appendValue<double>(fills, fill.price);
+        ++fillCount;
+    }
+
+    // Moves the fills gathered so far, if any, to the front of the reply
+    void takeFills(std::string& reply) {
+        if (fillCount == 0) return;
+        finishFrame(fills, fillsStart);
+        std::memcpy(&fills[fillsStart + sizeof(uint32_t) + sizeof(uint8_t)], &fillCount, sizeof(fillCount));
+        reply.insert(0, fills);
+    }
+};
+
+// Coordinator side of one link: batches orders for the shard and keeps at most `window`
+// of them un-acked. Frames coming back are handed to the caller's handler.
+class ShardLink {
+    int fd;
+    size_t batchSize;
+    size_t window;
+    std::string pending;  // Orders frame being built
+    size_t pendingStart = 0;
+    uint32_t pendingCount = 0;
+    size_t inFlight = 0;
+
+public:
+    long long framesSent = 0;
+    long long bytesSent = 0;
+    long long stalls = 0;  // Times a batch had to wait for credit
+
+    ShardLink(int socket, size_t batch, size_t windowOrders)
+        : fd(socket), batchSize(std::max<size_t>(1, batch)), window(std::max(windowOrders, batchSize)) {}
+
+    ~ShardLink() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    ShardLink(const ShardLink&) = delete;
+    ShardLink& operator=(const ShardLink&) = delete;
+
+    int socket() const { return fd; }
+
+    template <typename Handler>
+    bool assign(const std::vector<std::pair<std::string, double>>& books, bool auction, Handler& handler) {
+        std::string frame;
+        size_t start = beginFrame(frame, LinkAssign);
+        appendValue<uint8_t>(frame, auction ? 1 : 0);
+        appendValue<uint32_t>(frame, static_cast<uint32_t>(books.size()));
+        for (const auto& book : books) {
+            appendString(frame, book.first);
+            appendValue<double>(frame, book.second);
+        }
+        finishFrame(frame, start);
+        return send(frame, handler);
+    }
+
+    // Queues an order for the shard's book `index`; sends the batch once it is full
+    template <typename Handler>
+    bool submit(uint32_t index, const Order& order, Handler& handler) {
+        if (pendingCount == 0) {
+            pending.clear();
+            pendingStart = beginFrame(pending, LinkOrders);
+            appendValue<uint32_t>(pending, 0);
+        }
+        appendValue<uint32_t>(pending, index);
+        appendValue<int32_t>(pending, order.timestamp);
+        appendValue<uint8_t>(pending, static_cast<uint8_t>(order.type));
+        appendValue<uint8_t>(pending, order.isMarketOrder ? 1 : 0);
+        appendValue<double>(pending, order.limitPrice);
+        appendValue<int32_t>(pending, order.quantity);
+        appendString(pending, order.id);
+        return ++pendingCount < batchSize || flush(handler);
+    }
+
+    // Sends a partly filled batch
+    template <typename Handler>
+    bool flush(Handler& handler) {
+        if (pendingCount == 0) return true;
+        while (inFlight + pendingCount > window) {
+            ++stalls;
+            if (!receive(handler)) return false;
+        }
+        finishFrame(pending, pendingStart);
+        std::memcpy(&pending[pendingStart + sizeof(uint32_t) + sizeof(uint8_t)], &pendingCount, sizeof(pendingCount));
+        inFlight += pendingCount;
+        pendingCount = 0;
+        return send(pending, handler);
+    }
+
+    // Sends a bare control frame (Open or Finish) after any queued orders
+    template <typename Handler>
+    bool control(LinkFrameType type, Handler& handler) {
+        if (!flush(handler)) return false;
+        std::string frame;
+        finishFrame(frame, beginFrame(frame, type));
+        return send(frame, handler);
+    }
+
+    // Reads and handles one frame from the shard (blocks until one arrives)
+    template <typename Handler>
+    bool receive(Handler& handler) {
+        uint8_t type;
+        std::string payload;
+        if (!readFrame(fd, type, payload)) return false;
+        ByteReader reader(payload.data(), payload.size());
+        if (type == LinkAck) {
+            uint32_t count = 0;
+            if (!reader.read(count)) return false;
+            inFlight -= std::min<size_t>(inFlight, count);
+        }
+        return handler(type, reader);
+    }
+
+    // Handles whatever the shard has already sent, without waiting
+    template <typename Handler>
+    bool poll(Handler& handler) {
+        pollfd entry{fd, POLLIN, 0};
+        while (::poll(&entry, 1, 0) > 0 && (entry.revents & POLLIN)) {
+            if (!receive(handler)) return false;
+        }
+        return true;
+    }
+
+private:
+    template <typename Handler>
+    bool send(const std::string& frame, Handler& handler) {
+        ++framesSent;
+        bytesSent += static_cast<long long>(frame.size());
+        // Drain replies first so the shard is never stuck writing while we write to it
+        return poll(handler) && writeFully(fd, frame.data(), frame.size());
+    }
+};
+
+#endif
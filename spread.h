@@ -0,0 +1,308 @@
+#ifndef SPREAD_H
+#define SPREAD_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "orderbook.h"
+
+// Spread instruments (e.g. calendar spreads) traded next to their outright legs, each
+// with its own OrderBook, plus first-generation implied prices between them:
+//   implied-out  a spread's bid/ask built from the legs' best levels. Buying one spread
+//                buys `ratio` of every positive leg at its ask and sells |ratio| of
+//                every negative leg at its bid, so its price is sum(ratio * leg price).
+//   implied-in   an outright's bid/ask built from the best resting spread order plus the
+//                other legs' best levels (legs with ratio +-1 only, so the price stays
+//                in whole ticks)
+// An incoming order trades against whichever is better, real or implied, one level at a
+// time, with real orders first on a tie. Every implied trade checks that all books
+// involved have the quantity and then fills all of them in the same step, so a spread
+// never ends up partly legged. Implied-out quotes are cached per spread and rebuilt only
+// when one of its legs' top level changes (OrderBook::topVersion()).
+//
+// Leg executions appear in the leg books as orders named <orderId>.<legSymbol>#<n>, where
+// n numbers the implied executions in the market, so each partial fill of one spread
+// order gets ids of its own.
+
+struct ImpliedQuote {
+    bool valid = false;
+    long long priceTicks = 0;
+    long long quantity = 0;  // Units of the instrument the quote is for
+    size_t spread = 0;       // Implied-in: the spread whose resting order backs the quote
+};
+
+class SpreadMarket {
+    struct Leg {
+        size_t instrument;
+        int ratio;
+    };
+
+    struct Instrument {
+        std::string symbol;
+        OrderBook book;
+        std::vector<Leg> legs;       // Spreads only
+        std::vector<size_t> usedBy;  // Outrights: spreads that have it as a leg
+        std::vector<uint64_t> legVersions;  // Leg topVersion()s the cached quotes were built from
+        ImpliedQuote impliedBid;
+        ImpliedQuote impliedAsk;
+        long long impliedTrades = 0;
+
+        Instrument(const std::string& name, double initialPrice) : symbol(name), book(initialPrice) {}
+    };
+
+    std::vector<std::unique_ptr<Instrument>> instruments;
+    std::unordered_map<std::string, size_t> directory;
+    long long legExecutions = 0;  // Implied executions so far, for leg order ids
+
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    size_t addOutright(const std::string& symbol, double initialPrice) {
+        if (directory.count(symbol)) return npos;
+        instruments.push_back(std::make_unique<Instrument>(symbol, initialPrice));
+        return directory[symbol] = instruments.size() - 1;
+    }
+
+    // Legs are outrights added earlier, with non-zero ratios; returns npos otherwise.
+    // The spread's starting price is sum(ratio * leg price).
+    size_t addSpread(const std::string& symbol, const std::vector<std::pair<std::string, int>>& legs) {
+        if (directory.count(symbol) || legs.size() < 2) return npos;
+        std::vector<Leg> resolved;
+        double initialPrice = 0.0;
+        for (const auto& leg : legs) {
+            size_t index = find(leg.first);
+            if (index == npos || isSpread(index) || leg.second == 0) return npos;
+            resolved.push_back({index, leg.second});
+            initialPrice += leg.second * instruments[index]->book.getLastTradedPrice();
+        }
+        size_t spread = instruments.size();
+        instruments.push_back(std::make_unique<Instrument>(symbol, std::round(initialPrice * 100.0) / 100.0));
+        instruments.back()->legs = resolved;
+        for (const auto& leg : resolved) instruments[leg.instrument]->usedBy.push_back(spread);
+        directory[symbol] = spread;
+        return spread;
+    }
+
+    size_t find(const std::string& symbol) const {
+        auto it = directory.find(symbol);
+        return it == directory.end() ? npos : it->second;
+    }
+
+    size_t size() const { return instruments.size(); }
+    const std::string& symbolOf(size_t index) const { return instruments[index]->symbol; }
+    OrderBook& bookOf(size_t index) { return instruments[index]->book; }
+    bool isSpread(size_t index) const { return !instruments[index]->legs.empty(); }
+    long long impliedTradeCount(size_t index) const { return instruments[index]->impliedTrades; }
+
+    // Best implied quote for an instrument: side 'B' for the bid (what an incoming sell
+    // can hit), 'S' for the ask. Implied-out for spreads, implied-in for outrights.
+    ImpliedQuote implied(size_t index, char side) {
+        if (isSpread(index)) {
+            refreshImpliedOut(index);
+            return side == 'B' ? instruments[index]->impliedBid : instruments[index]->impliedAsk;
+        }
+        return impliedIn(index, side);
+    }
+
+    // Routes one input line for an instrument: cancels go straight to its book; orders
+    // trade against real and implied liquidity and the remainder rests
+    void submit(size_t index, const Order& order, std::ostream& output) {
+        Instrument& instrument = *instruments[index];
+        if (order.type == 'C') {
+            instrument.book.submit(order, output);
+            return;
+        }
+        Order rest = order;
+        char opposite = order.type == 'B' ? 'S' : 'B';
+        while (rest.quantity > 0) {
+            ImpliedQuote quote = implied(index, opposite);
+            if (!quote.valid || !withinLimit(rest, quote.priceTicks)) break;
+            long long directTicks = 0, directQuantity = 0;
+            bool hasDirect = order.type == 'B' ? instrument.book.bestAsk(directTicks, directQuantity)
+                                               : instrument.book.bestBid(directTicks, directQuantity);
+            bool impliedBetter = !hasDirect || (order.type == 'B' ? quote.priceTicks < directTicks
+                                                                  : quote.priceTicks > directTicks);
+            int units = static_cast<int>(std::min<long long>(rest.quantity, impliedBetter ? quote.quantity : directQuantity));
+            if (!impliedBetter) {
+                // Take the real level first, then compare again
+                Order part = rest;
+                part.quantity = units;
+                part.isMarketOrder = false;
+                part.limitPrice = directTicks / 100.0;
+                instrument.book.submit(part, output);
+            } else if (isSpread(index)) {
+                tradeLegs(index, rest.type == 'B' ? 1 : -1, units, rest.id, rest.timestamp, npos, output);
+                instrument.book.fillIncoming(rest, units, quote.priceTicks / 100.0, "implied", output);
+                ++instrument.impliedTrades;
+            } else {
+                fillImpliedIn(index, quote, rest, units, output);
+            }
+            rest.quantity -= units;
+        }
+        if (rest.quantity > 0) instrument.book.submit(rest, output);
+
+        // Resting spread orders this made marketable against the legs
+        if (isSpread(index)) {
+            crossImplied(index, output);
+        } else {
+            for (size_t spread : instrument.usedBy) crossImplied(spread, output);
+        }
+    }
+
+private:
+    static bool withinLimit(const Order& order, long long ticks) {
+        if (order.isMarketOrder) return true;
+        long long limit = std::llround(order.limitPrice * 100.0);
+        return order.type == 'B' ? ticks <= limit : ticks >= limit;
+    }
+
+    static int sign(int value) { return value > 0 ? 1 : -1; }
+
+    // The level a trade in `direction` (+1 buy, -1 sell) would take from an outright
+    bool legTop(size_t leg, int direction, long long& ticks, long long& quantity) const {
+        const OrderBook& book = instruments[leg]->book;
+        return direction > 0 ? book.bestAsk(ticks, quantity) : book.bestBid(ticks, quantity);
+    }
+
+    void refreshImpliedOut(size_t spread) {
+        Instrument& instrument = *instruments[spread];
+        std::vector<uint64_t> versions;
+        versions.reserve(instrument.legs.size());
+        for (const auto& leg : instrument.legs) versions.push_back(instruments[leg.instrument]->book.topVersion());
+        if (versions == instrument.legVersions) return;
+        instrument.legVersions.swap(versions);
+        instrument.impliedBid = impliedOut(spread, -1);
+        instrument.impliedAsk = impliedOut(spread, 1);
+    }
+
+    // Price and size for buying (direction 1) or selling (-1) the spread through its legs
+    ImpliedQuote impliedOut(size_t spread, int direction) const {
+        ImpliedQuote quote;
+        quote.quantity = -1;
+        for (const auto& leg : instruments[spread]->legs) {
+            long long ticks, quantity;
+            if (!legTop(leg.instrument, direction * sign(leg.ratio), ticks, quantity)) return ImpliedQuote();
+            quote.priceTicks += leg.ratio * ticks;
+            long long units = quantity / std::abs(leg.ratio);
+            if (quote.quantity < 0 || units < quote.quantity) quote.quantity = units;
+        }
+        quote.valid = quote.quantity > 0;
+        quote.spread = spread;
+        return quote;
+    }
+
+    // The resting spread order that would trade in `direction` (+1: the best spread bid,
+    // a buyer; -1: the best ask), if it is a limit order at the top level
+    const Order* restingSpreadOrder(size_t spread, int direction) {
+        OrderBook& book = instruments[spread]->book;
+        long long ticks, quantity;
+        if (!(direction > 0 ? book.bestBid(ticks, quantity) : book.bestAsk(ticks, quantity))) return nullptr;
+        const Order* top = book.topOrder(direction > 0 ? 'B' : 'S');
+        if (!top || top->isMarketOrder || std::llround(top->limitPrice * 100.0) != ticks) return nullptr;
+        return top;
+    }
+
+    // Best implied-in quote for an outright: side 'B' is a bid, i.e. a spread order that
+    // would buy this leg, combined with the other legs' best levels
+    ImpliedQuote impliedIn(size_t outright, char side) {
+        ImpliedQuote best;
+        int legDirection = side == 'B' ? 1 : -1;  // What the spread side does in this leg
+        for (size_t spread : instruments[outright]->usedBy) {
+            const Instrument& instrument = *instruments[spread];
+            int ratio = 0;
+            for (const auto& leg : instrument.legs) {
+                if (leg.instrument == outright) ratio = leg.ratio;
+            }
+            if (std::abs(ratio) != 1) continue;
+            int spreadDirection = legDirection * ratio;
+            const Order* resting = restingSpreadOrder(spread, spreadDirection);
+            if (!resting) continue;
+
+            long long others = 0, units = resting->quantity;
+            bool available = true;
+            for (const auto& leg : instrument.legs) {
+                if (leg.instrument == outright) continue;
+                long long ticks, quantity;
+                if (!legTop(leg.instrument, spreadDirection * sign(leg.ratio), ticks, quantity)) {
+                    available = false;
+                    break;
+                }
+                others += leg.ratio * ticks;
+                units = std::min(units, quantity / std::abs(leg.ratio));
+            }
+            if (!available || units <= 0) continue;
+            long long ticks = ratio * (std::llround(resting->limitPrice * 100.0) - others);
+            bool better = !best.valid || (side == 'B' ? ticks > best.priceTicks : ticks < best.priceTicks);
+            if (better) best = ImpliedQuote{true, ticks, units, spread};
+        }
+        return best;
+    }
+
+    // Sends the leg orders for `units` of a spread bought (1) or sold (-1) by `owner`,
+    // skipping one leg if its side of the trade happens elsewhere. Each leg order takes
+    // exactly the top level it was priced from, which the caller has checked is big enough.
+    void tradeLegs(size_t spread, int direction, int units, const std::string& owner, int timestamp, size_t skip,
+                   std::ostream& output) {
+        std::string execution = "#" + std::to_string(++legExecutions);
+        for (const auto& leg : instruments[spread]->legs) {
+            if (leg.instrument == skip) continue;
+            int legDirection = direction * sign(leg.ratio);
+            long long ticks = 0, quantity = 0;
+            legTop(leg.instrument, legDirection, ticks, quantity);
+            Order child;
+            child.id = owner + "." + instruments[leg.instrument]->symbol + execution;
+            child.type = legDirection > 0 ? 'B' : 'S';
+            child.quantity = units * std::abs(leg.ratio);
+            child.limitPrice = ticks / 100.0;
+            child.isMarketOrder = false;
+            child.timestamp = timestamp;
+            instruments[leg.instrument]->book.submit(child, output);
+        }
+    }
+
+    // An incoming outright order against a resting spread order and the other legs
+    void fillImpliedIn(size_t outright, const ImpliedQuote& quote, const Order& incoming, int units,
+                       std::ostream& output) {
+        Instrument& spread = *instruments[quote.spread];
+        int ratio = 0;
+        for (const auto& leg : spread.legs) {
+            if (leg.instrument == outright) ratio = leg.ratio;
+        }
+        int spreadDirection = (incoming.type == 'B' ? -1 : 1) * ratio;
+        const Order* resting = restingSpreadOrder(quote.spread, spreadDirection);
+        std::string owner = resting->id;
+        double spreadPrice = resting->limitPrice;
+        tradeLegs(quote.spread, spreadDirection, units, owner, incoming.timestamp, outright, output);
+        spread.book.fillTop(spreadDirection > 0 ? 'B' : 'S', units, spreadPrice, incoming.id, output);
+        instruments[outright]->book.fillIncoming(incoming, units, quote.priceTicks / 100.0, owner, output);
+        ++spread.impliedTrades;
+    }
+
+    // Trades resting spread orders that cross the spread's implied-out prices
+    void crossImplied(size_t spread, std::ostream& output) {
+        Instrument& instrument = *instruments[spread];
+        while (true) {
+            bool traded = false;
+            for (int direction : {1, -1}) {
+                const Order* resting = restingSpreadOrder(spread, direction);
+                ImpliedQuote quote = implied(spread, direction > 0 ? 'S' : 'B');
+                if (!resting || !quote.valid || !withinLimit(*resting, quote.priceTicks)) continue;
+                int units = static_cast<int>(std::min<long long>(resting->quantity, quote.quantity));
+                std::string owner = resting->id;
+                tradeLegs(spread, direction, units, owner, instrument.book.getCurrentTime(), npos, output);
+                instrument.book.fillTop(direction > 0 ? 'B' : 'S', units, quote.priceTicks / 100.0, "implied", output);
+                ++instrument.impliedTrades;
+                traded = true;
+            }
+            if (!traded) return;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "orderbook.h"
+#include "spread.h"
+#include "symbol_directory.h"
+#include "symbol_scheduler.h"
+
+// Runs outrights and spreads on them with implied pricing (spread.h).
+//   ./spreads <input_file>
+// The input starts like the multi-symbol format (symbol_scheduler.h): a count, then one
+// instrument per line, either an outright "<symbol> <price>" or a spread
+// "<symbol> = <leg>:<ratio> <leg>:<ratio> ..." over outrights listed above it (e.g.
+// "CAL = DEC:1 MAR:-1" buys DEC and sells MAR). Symbol-prefixed orders follow. Fills
+// go to the output file named as for main, then each instrument's unexecuted orders.
+namespace {
+
+std::string quoteText(const ImpliedQuote& quote) {
+    return quote.valid ? formatPrice(quote.priceTicks / 100.0) + "x" + std::to_string(quote.quantity) : "-";
+}
+
+std::string levelText(bool valid, long long ticks, long long quantity) {
+    return valid ? formatPrice(ticks / 100.0) + "x" + std::to_string(quantity) : "-";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: ./spreads <input_file>\n";
+        return 1;
+    }
+    std::string inputFilename = argv[1];
+    std::ifstream inputFile(inputFilename);
+    if (!inputFile) {
+        std::cerr << "Error: Could not open file " << inputFilename << "\n";
+        return 1;
+    }
+    std::string outputFilename = inputFilename;
+    size_t inputPos = inputFilename.find("input");
+    if (inputPos != std::string::npos) {
+        outputFilename.replace(inputPos, 5, "output");
+    } else {
+        outputFilename = inputFilename.substr(0, inputFilename.find_last_of('.')) + ".out";
+    }
+    std::ofstream outputFile(outputFilename);
+
+    SpreadMarket market;
+    std::string line;
+    int instrumentCount = 0;
+    if (std::getline(inputFile, line)) instrumentCount = std::atoi(line.c_str());
+    for (int i = 0; i < instrumentCount && std::getline(inputFile, line); ++i) {
+        std::istringstream iss(line);
+        std::string symbol, next;
+        iss >> symbol >> next;
+        size_t added = SpreadMarket::npos;
+        if (next == "=") {
+            std::vector<std::pair<std::string, int>> legs;
+            std::string leg;
+            while (iss >> leg) {
+                size_t colon = leg.find(':');
+                if (colon == std::string::npos) break;
+                legs.emplace_back(leg.substr(0, colon), std::atoi(leg.c_str() + colon + 1));
+            }
+            added = market.addSpread(symbol, legs);
+        } else if (!next.empty()) {
+            added = market.addOutright(symbol, std::atof(next.c_str()));
+        }
+        if (added == SpreadMarket::npos) {
+            std::cerr << "Error: Invalid instrument line: " << line << "\n";
+            return 1;
+        }
+    }
+    if (market.size() == 0) {
+        std::cerr << "Error: No instruments in " << inputFilename << "\n";
+        return 1;
+    }
+
+    // Orders only look instruments up from here on, so compile the universe once
+    std::vector<std::string> names;
+    for (size_t i = 0; i < market.size(); ++i) names.push_back(market.symbolOf(i));
+    SymbolDirectory directory(names);
+
+    std::string symbol, orderText;
+    int timestamp = instrumentCount + 1;
+    long long orderCount = 0;
+    while (std::getline(inputFile, line)) {
+        ++timestamp;
+        if (!splitSymbolLine(line, symbol, orderText)) continue;
+        size_t index = directory.find(symbol);
+        if (index == SymbolDirectory::npos) {
+            std::cerr << "Error: Unknown symbol " << symbol << " on line " << timestamp << "\n";
+            return 1;
+        }
+        market.submit(index, parseOrder(orderText, timestamp), outputFile);
+        ++orderCount;
+    }
+
+    long long impliedTrades = 0;
+    std::cout << "symbol last bid ask implied_bid implied_ask implied_trades open_orders\n";
+    for (size_t i = 0; i < market.size(); ++i) {
+        OrderBook& book = market.bookOf(i);
+        long long bidTicks = 0, bidQuantity = 0, askTicks = 0, askQuantity = 0;
+        bool hasBid = book.bestBid(bidTicks, bidQuantity);
+        bool hasAsk = book.bestAsk(askTicks, askQuantity);
+        std::cout << market.symbolOf(i) << " " << formatPrice(book.getLastTradedPrice()) << " "
+                  << levelText(hasBid, bidTicks, bidQuantity) << " " << levelText(hasAsk, askTicks, askQuantity) << " "
+                  << quoteText(market.implied(i, 'B')) << " " << quoteText(market.implied(i, 'S')) << " "
+                  << market.impliedTradeCount(i) << " " << book.openOrderCount() << "\n";
+        impliedTrades += market.impliedTradeCount(i);
+    }
+    std::cout << "Processed " << orderCount << " orders for " << market.size() << " instruments, " << impliedTrades
+              << " implied trades\n";
+    for (size_t i = 0; i < market.size(); ++i) market.bookOf(i).writeUnexecutedOrders(outputFile);
+    return 0;
+}
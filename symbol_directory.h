@@ -0,0 +1,131 @@
+#ifndef SYMBOL_DIRECTORY_H
+#define SYMBOL_DIRECTORY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Symbol -> index lookup for a universe known up front (the symbol list at the top of a
+// multi-symbol input), compiled at startup into a minimal perfect hash: n symbols in n
+// slots, every one in a slot of its own. Built by hash-and-displace (Belazzougui et al.,
+// "Hash, displace, and compress"): symbols are hashed into buckets of about four, and
+// each bucket gets the first pilot value that sends all of its symbols to free slots,
+// biggest buckets first.
+//
+// find() is one hash of the symbol, one pilot read and one slot: no chains, no probing.
+// A perfect hash sends any string to some slot, so the slot's symbol is compared once
+// to turn away symbols outside the universe. Building takes a few milliseconds for
+// thousands of symbols. The universe cannot change afterwards; build() again for a new one.
+class SymbolDirectory {
+    std::vector<uint32_t> pilots;     // One per bucket
+    std::vector<std::string> keys;    // Symbol in each slot
+    std::vector<size_t> values;       // Its index in the list given to build()
+    uint64_t seed = 0;
+
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    SymbolDirectory() = default;
+    explicit SymbolDirectory(const std::vector<std::string>& symbols) { build(symbols); }
+
+    // Maps each symbol to its position in `symbols`; a repeated symbol gets its last one
+    void build(const std::vector<std::string>& symbols) {
+        std::unordered_map<std::string, size_t> distinct;
+        for (size_t i = 0; i < symbols.size(); ++i) distinct[symbols[i]] = i;
+        std::vector<std::pair<std::string, size_t>> entries(distinct.begin(), distinct.end());
+        std::sort(entries.begin(), entries.end());  // Same layout whatever the map's order
+        // A pilot search can only fail on a rare full-hash collision; a new seed fixes it
+        for (seed = 0; !tryBuild(entries); ++seed) {
+        }
+    }
+
+    // Index of `symbol` in the list it was built from, npos if it is not in it
+    size_t find(const std::string& symbol) const {
+        if (keys.empty()) return npos;
+        uint64_t hash = hashOf(symbol, seed);
+        size_t slot = slotOf(hash, pilots[bucketOf(hash)]);
+        return keys[slot] == symbol ? values[slot] : npos;
+    }
+
+    size_t size() const { return keys.size(); }
+    bool empty() const { return keys.empty(); }
+
+private:
+    bool tryBuild(const std::vector<std::pair<std::string, size_t>>& entries) {
+        size_t count = entries.size();
+        size_t bucketCount = std::max<size_t>(1, (count + 3) / 4);
+        pilots.assign(bucketCount, 0);
+        keys.assign(count, std::string());
+        values.assign(count, npos);
+        if (count == 0) return true;
+
+        std::vector<uint64_t> hashes(count);
+        std::vector<std::vector<size_t>> buckets(bucketCount);
+        for (size_t i = 0; i < count; ++i) {
+            hashes[i] = hashOf(entries[i].first, seed);
+            buckets[bucketOf(hashes[i])].push_back(i);
+        }
+        std::vector<size_t> order(bucketCount);
+        for (size_t b = 0; b < bucketCount; ++b) order[b] = b;
+        std::stable_sort(order.begin(), order.end(),
+                         [&buckets](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+        std::vector<bool> taken(count, false);
+        std::vector<size_t> slots;
+        // The last buckets go into the last few free slots, so allow plenty of tries
+        uint64_t maxPilot = std::min<uint64_t>(UINT32_MAX, 64 * static_cast<uint64_t>(count) + 1024);
+        for (size_t b : order) {
+            const std::vector<size_t>& bucket = buckets[b];
+            if (bucket.empty()) break;
+            bool placed = false;
+            for (uint64_t pilot = 0; pilot < maxPilot && !placed; ++pilot) {
+                slots.clear();
+                placed = true;
+                for (size_t i : bucket) {
+                    size_t slot = slotOf(hashes[i], static_cast<uint32_t>(pilot));
+                    if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                        placed = false;
+                        break;
+                    }
+                    slots.push_back(slot);
+                }
+                if (placed) pilots[b] = static_cast<uint32_t>(pilot);
+            }
+            if (!placed) return false;
+            for (size_t k = 0; k < bucket.size(); ++k) {
+                taken[slots[k]] = true;
+                keys[slots[k]] = entries[bucket[k]].first;
+                values[slots[k]] = entries[bucket[k]].second;
+            }
+        }
+        return true;
+    }
+
+    // splitmix64's finalizer: every input bit reaches every output bit
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ULL;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    static uint64_t hashOf(const std::string& symbol, uint64_t seed) {
+        uint64_t hash = 1469598103934665603ULL ^ mix(seed);  // FNV-1a, keyed by the seed
+        for (unsigned char c : symbol) hash = (hash ^ c) * 1099511628211ULL;
+        return mix(hash);
+    }
+
+    // Range reductions by multiply-shift rather than %: bucket from the hash's top half,
+    // slot from the hash re-mixed with the bucket's pilot
+    size_t bucketOf(uint64_t hash) const { return static_cast<size_t>(((hash >> 32) * pilots.size()) >> 32); }
+
+    size_t slotOf(uint64_t hash, uint32_t pilot) const {
+        uint64_t mixed = mix(hash ^ (pilot * 0x9E3779B97F4A7C15ULL));
+        return static_cast<size_t>(((mixed >> 32) * keys.size()) >> 32);
+    }
+};
+
+#endif
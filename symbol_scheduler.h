@@ -0,0 +1,484 @@
+#ifndef SYMBOL_SCHEDULER_H
+#define SYMBOL_SCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "orderbook.h"
+
+// Many symbols, one OrderBook each. Multi-symbol input files start with the universe and
+// then carry one order per line, prefixed with its symbol:
+//     <symbol count>
+//     <symbol> <last traded price>       (once per symbol)
+//     <symbol> <orderID> <B|S> <quantity> [<limitPrice>]
+//     <symbol> <orderID> C
+//     OPEN                               (optional)
+//     BASKET <basketID> <leg count>      (followed by that many order lines)
+// Timestamps are line numbers across the whole file, so they increase within every symbol.
+// If there is an OPEN line, the orders before it are collected for the opening auction
+// and every symbol uncrosses at that point; continuous trading follows.
+// A basket is accepted or rejected as a whole and its legs are dispatched in one go.
+
+// Splits "<symbol> <rest of order line>"; returns false if there is no symbol
+inline bool splitSymbolLine(const std::string& line, std::string& symbol, std::string& orderText) {
+    size_t space = line.find(' ');
+    if (space == 0 || space == std::string::npos) return false;
+    symbol = line.substr(0, space);
+    orderText = line.substr(space + 1);
+    return true;
+}
+
+struct SymbolBook;
+
+// An order together with the book it is routed to
+struct RoutedOrder {
+    SymbolBook* target;
+    Order order;
+};
+
+// All-or-none check of a basket's legs: every leg a new buy or sell with a positive
+// quantity (and price, for limits) for a known book, and no order id used twice.
+// Returns false with the first problem in `reason`.
+inline bool validateBasket(const RoutedOrder* legs, size_t count, std::string& reason) {
+    if (count == 0) {
+        reason = "no legs";
+        return false;
+    }
+    std::unordered_set<std::string> ids;
+    for (size_t i = 0; i < count; ++i) {
+        const Order& order = legs[i].order;
+        std::string leg = "leg " + std::to_string(i + 1) + " (" + order.id + ")";
+        if (!legs[i].target) reason = leg + ": unknown symbol";
+        else if (order.type != 'B' && order.type != 'S') reason = leg + ": not a buy or sell";
+        else if (order.quantity <= 0) reason = leg + ": quantity must be positive";
+        else if (!order.isMarketOrder && order.limitPrice <= 0.0) reason = leg + ": price must be positive";
+        else if (!ids.insert(order.id).second) reason = leg + ": duplicate order id";
+        else continue;
+        return false;
+    }
+    return true;
+}
+
+// One symbol's book plus the orders waiting for it. The symbol is a serial task queue:
+// at most one worker runs it at a time, so its orders are always applied in arrival order.
+struct SymbolBook {
+    static constexpr size_t noMove = static_cast<size_t>(-1);
+
+    std::string symbol;
+    OrderBook book;
+
+    std::mutex inboxMutex;
+    std::deque<Order> inbox;
+    size_t home = 0;          // Worker the symbol is queued on when it becomes ready
+    size_t movingTo = noMove; // Home to switch to once the inbox drains
+    bool scheduled = false;   // Queued on a worker or running
+    // (inbox, home, movingTo and scheduled are guarded by inboxMutex)
+
+    long long processed = 0;  // Only touched by the worker running the symbol
+    std::ostringstream output;  // Continuous-trading fills, written by the worker running the symbol
+    AuctionCross opening{0.0, 0, 0};  // Result of the opening cross, if there was one
+    std::atomic<long long> arrived{0};  // Orders submitted since the last rebalance
+    double rate = 0.0;        // Smoothed orders per rebalance window; rebalancer only
+
+    SymbolBook(const std::string& name, double initialPrice) : symbol(name), book(initialPrice) {}
+};
+
+// Runs symbol queues on a pool of worker threads. A symbol with pending orders is
+// queued on its home worker; a worker with nothing of its own to do steals a ready
+// symbol from the back of another worker's queue. A hot symbol therefore occupies one
+// worker at a time while everything else flows around it, instead of stalling the cold
+// symbols that happen to share its static shard. With stealing off this is plain static
+// symbol-to-thread sharding, for comparison.
+//
+// Homes are not fixed either: every rebalanceInterval submitted orders the scheduler
+// compares per-symbol arrival rates and moves hot symbols from the busiest worker to the
+// idlest one. A move only takes effect at a quiescent point, once the symbol's inbox has
+// drained on its old worker, so no order of that symbol is ever queued in two places.
+// The book itself stays where it is in memory; the new worker simply picks it up.
+//
+// The opening auction uncrosses every symbol at the same instant, so it is spread over
+// the same workers: they claim symbols in small chunks and write the fills into their
+// own buffers, which are then stitched together in symbol order. The result is the same
+// for any number of threads.
+//
+// Continuous-trading fills go to the symbol's own output buffer, whichever worker runs
+// it, and finish() writes the buffers out in symbol order. That output is the same for
+// any thread count, mode or migration too.
+class SymbolScheduler {
+    struct Worker {
+        std::mutex mutex;
+        std::deque<SymbolBook*> ready;
+        long long orders = 0;
+        long long steals = 0;
+        std::thread thread;
+        std::ostringstream auctionOutput;  // This worker's share of the opening fills
+    };
+
+    // Where one symbol's opening fills ended up
+    struct AuctionSlice {
+        size_t worker;
+        std::streamoff begin;
+        std::streamoff end;
+    };
+
+    std::vector<std::unique_ptr<SymbolBook>> symbols;
+    std::vector<std::unique_ptr<Worker>> workers;
+    bool stealing;
+    size_t batchSize;  // Orders run per turn before a symbol goes to the back of the queue
+    long long rebalanceInterval;
+
+    std::atomic<long long> submitted{0};
+    std::mutex rebalanceMutex;
+    std::atomic<long long> migrationsDone{0};
+
+    // Waits: idle workers on `wakeup`, drain() and openingCross() on `idle`. Whatever
+    // changes what a waiter checks takes idleMutex before notifying (wake()), so a change
+    // cannot slip in between a waiter's check and its wait.
+    std::atomic<long long> pendingSymbols{0};  // Symbols scheduled but not yet drained
+    std::atomic<bool> closing{false};
+    std::mutex idleMutex;
+    std::condition_variable wakeup;
+    std::condition_variable idle;
+
+    std::atomic<bool> auctionRunning{false};
+    std::atomic<size_t> auctionNext{0};  // Next symbol to claim
+    std::atomic<size_t> auctionDone{0};  // Symbols uncrossed
+    std::vector<AuctionSlice> auctionSlices;
+
+public:
+    // rebalance: orders between load checks, 0 keeps the initial homes
+    SymbolScheduler(unsigned threadCount, bool workStealing = true, size_t batch = 64, long long rebalance = 50000)
+        : stealing(workStealing), batchSize(batch), rebalanceInterval(rebalance) {
+        for (unsigned i = 0; i < std::max(1u, threadCount); ++i) workers.push_back(std::make_unique<Worker>());
+    }
+
+    ~SymbolScheduler() { finish(); }
+
+    SymbolScheduler(const SymbolScheduler&) = delete;
+    SymbolScheduler& operator=(const SymbolScheduler&) = delete;
+
+    // Symbols must all be added before start(); homes are dealt out round-robin
+    SymbolBook& addSymbol(const std::string& symbol, double initialPrice) {
+        symbols.push_back(std::make_unique<SymbolBook>(symbol, initialPrice));
+        symbols.back()->home = (symbols.size() - 1) % workers.size();
+        return *symbols.back();
+    }
+
+    const std::vector<std::unique_ptr<SymbolBook>>& getSymbols() const { return symbols; }
+
+    void start() {
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i]->thread = std::thread([this, i] { runWorker(i); });
+        }
+    }
+
+    // Hands an order to its symbol; safe to call from any thread, but orders for one
+    // symbol must come from one thread to keep their order
+    void submit(SymbolBook& target, const Order& order) {
+        bool wasIdle;
+        size_t home;
+        {
+            std::lock_guard<std::mutex> lock(target.inboxMutex);
+            target.inbox.push_back(order);
+            wasIdle = !target.scheduled;
+            target.scheduled = true;
+            home = target.home;
+        }
+        target.arrived.fetch_add(1, std::memory_order_relaxed);
+        if (wasIdle) enqueue(home, &target);
+        if (rebalanceInterval > 0 && ++submitted % rebalanceInterval == 0) rebalance();
+    }
+
+    // Hands a whole basket to its books in one dispatch: each book's legs go into its inbox
+    // under a single lock, in basket order, and the books that become ready are queued
+    // with one lock per worker and one wakeup. Validate the basket first; the same
+    // threading rule as submit() applies.
+    void submitBasket(const RoutedOrder* legs, size_t count) {
+        std::vector<size_t> byBook(count);
+        for (size_t i = 0; i < count; ++i) byBook[i] = i;
+        std::stable_sort(byBook.begin(), byBook.end(), [legs](size_t a, size_t b) {
+            return std::less<SymbolBook*>()(legs[a].target, legs[b].target);
+        });
+        std::vector<std::vector<SymbolBook*>> ready(workers.size());
+        for (size_t first = 0; first < count;) {
+            SymbolBook& target = *legs[byBook[first]].target;
+            size_t last = first;
+            {
+                std::lock_guard<std::mutex> lock(target.inboxMutex);
+                for (; last < count && legs[byBook[last]].target == &target; ++last) {
+                    target.inbox.push_back(legs[byBook[last]].order);
+                }
+                if (!target.scheduled) {
+                    target.scheduled = true;
+                    ready[target.home].push_back(&target);
+                }
+            }
+            target.arrived.fetch_add(static_cast<long long>(last - first), std::memory_order_relaxed);
+            first = last;
+        }
+        bool queued = false;
+        for (size_t worker = 0; worker < workers.size(); ++worker) {
+            if (ready[worker].empty()) continue;
+            // Counted before a worker can see (and drain) them
+            pendingSymbols += static_cast<long long>(ready[worker].size());
+            std::lock_guard<std::mutex> lock(workers[worker]->mutex);
+            workers[worker]->ready.insert(workers[worker]->ready.end(), ready[worker].begin(), ready[worker].end());
+            queued = true;
+        }
+        if (queued) wake(wakeup, true);
+        long long before = submitted.fetch_add(static_cast<long long>(count));
+        if (rebalanceInterval > 0 && before / rebalanceInterval != (before + static_cast<long long>(count)) / rebalanceInterval) {
+            rebalance();
+        }
+    }
+
+    // Moves a symbol to another worker as soon as it is quiescent
+    void migrate(SymbolBook& symbol, size_t worker) {
+        std::lock_guard<std::mutex> lock(symbol.inboxMutex);
+        if (worker == symbol.home) {
+            symbol.movingTo = SymbolBook::noMove;
+            return;
+        }
+        if (symbol.scheduled) {
+            symbol.movingTo = worker;  // Drains on the old worker first
+        } else {
+            symbol.home = worker;
+            ++migrationsDone;
+        }
+    }
+
+    // Waits until every submitted order has been processed; the workers keep running
+    void drain() {
+        std::unique_lock<std::mutex> lock(idleMutex);
+        idle.wait(lock, [this] { return pendingSymbols == 0; });
+    }
+
+    // Runs the opening auction: drains the pre-open orders, uncrosses every symbol that
+    // is in its auction phase on the worker pool and writes each symbol's result and
+    // fills to `output` in symbol order. Must be called from the submitting thread
+    // after start(). Returns the total volume crossed.
+    long long openingCross(std::ostream& output) {
+        drain();
+        auctionSlices.assign(symbols.size(), AuctionSlice{0, 0, 0});
+        for (auto& worker : workers) worker->auctionOutput.str("");
+        auctionNext = 0;
+        auctionDone = 0;
+        auctionRunning = true;
+        wake(wakeup, true);
+        {
+            std::unique_lock<std::mutex> lock(idleMutex);
+            idle.wait(lock, [this] { return auctionDone == symbols.size(); });
+        }
+        auctionRunning = false;
+
+        long long volume = 0;
+        std::vector<std::string> buffers;
+        for (auto& worker : workers) buffers.push_back(worker->auctionOutput.str());
+        for (size_t i = 0; i < symbols.size(); ++i) {
+            const SymbolBook& symbol = *symbols[i];
+            const AuctionSlice& slice = auctionSlices[i];
+            volume += symbol.opening.volume;
+            output << symbol.symbol << " opened at " << formatPrice(symbol.opening.price) << " with "
+                   << symbol.opening.volume << " shares, imbalance " << symbol.opening.imbalance << "\n";
+            output.write(buffers[slice.worker].data() + slice.begin, slice.end - slice.begin);
+        }
+        return volume;
+    }
+
+    // Stops the symbols keeping their continuous-trading output, for runs that do not
+    // want it; call before start()
+    void discardOutput() {
+        for (auto& symbol : symbols) symbol->output.setstate(std::ios::badbit);
+    }
+
+    // finish(), then writes each symbol's continuous-trading output to `output` in symbol
+    // order, under a "<symbol> fills" line
+    void finish(std::ostream& output) {
+        finish();
+        for (auto& symbol : symbols) {
+            output << symbol->symbol << " fills\n";
+            std::string text = symbol->output.str();
+            output.write(text.data(), static_cast<std::streamsize>(text.size()));
+            symbol->output.str("");
+        }
+    }
+
+    // Waits until every submitted order has been processed, then stops the workers
+    void finish() {
+        closing = true;
+        wake(wakeup, true);
+        for (auto& worker : workers) {
+            if (worker->thread.joinable()) worker->thread.join();
+        }
+    }
+
+    size_t workerCount() const { return workers.size(); }
+    long long ordersRunBy(size_t worker) const { return workers[worker]->orders; }
+    long long stealsBy(size_t worker) const { return workers[worker]->steals; }
+    long long migrations() const { return migrationsDone; }
+
+    // Re-estimates per-symbol rates and moves symbols off the busiest worker while that
+    // narrows the gap to the idlest one. Runs automatically from submit().
+    void rebalance() {
+        std::unique_lock<std::mutex> guard(rebalanceMutex, std::try_to_lock);
+        if (!guard.owns_lock() || workers.size() < 2) return;
+        std::vector<double> load(workers.size(), 0.0);
+        std::vector<size_t> homes(symbols.size());
+        for (size_t i = 0; i < symbols.size(); ++i) {
+            SymbolBook& symbol = *symbols[i];
+            symbol.rate = 0.5 * symbol.rate + 0.5 * symbol.arrived.exchange(0, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(symbol.inboxMutex);
+            homes[i] = symbol.movingTo != SymbolBook::noMove ? symbol.movingTo : symbol.home;
+            load[homes[i]] += symbol.rate;
+        }
+        double total = 0.0;
+        for (double value : load) total += value;
+        for (size_t move = 0; move < workers.size(); ++move) {
+            size_t busiest = std::max_element(load.begin(), load.end()) - load.begin();
+            size_t idlest = std::min_element(load.begin(), load.end()) - load.begin();
+            double gap = load[busiest] - load[idlest];
+            if (gap <= 0.1 * total / workers.size()) break;  // Close enough
+            // The hottest symbol that still fits in the gap; a bigger one would only swap roles
+            size_t best = symbols.size();
+            for (size_t i = 0; i < symbols.size(); ++i) {
+                if (homes[i] != busiest || symbols[i]->rate >= gap || symbols[i]->rate <= 0.0) continue;
+                if (best == symbols.size() || symbols[i]->rate > symbols[best]->rate) best = i;
+            }
+            if (best == symbols.size()) break;
+            migrate(*symbols[best], idlest);
+            homes[best] = idlest;
+            load[busiest] -= symbols[best]->rate;
+            load[idlest] += symbols[best]->rate;
+        }
+    }
+
+private:
+    void enqueue(size_t worker, SymbolBook* symbol) {
+        // Counted before a worker can see (and drain) it, so the count never dips below zero
+        bool first = pendingSymbols++ == 0;
+        {
+            std::lock_guard<std::mutex> lock(workers[worker]->mutex);
+            workers[worker]->ready.push_back(symbol);
+        }
+        // Without stealing only its home worker can take it, so wake them all
+        wake(wakeup, first || !stealing);
+    }
+
+    void wake(std::condition_variable& condition, bool all) {
+        { std::lock_guard<std::mutex> lock(idleMutex); }
+        if (all) {
+            condition.notify_all();
+        } else {
+            condition.notify_one();
+        }
+    }
+
+    // Whether an idle worker has something to do: a symbol it may take or auction symbols
+    // left to claim. Called under idleMutex; takes the worker locks after it.
+    bool hasWork(size_t self) {
+        if (auctionRunning && auctionNext < symbols.size()) return true;
+        for (size_t offset = 0; offset < (stealing ? workers.size() : 1); ++offset) {
+            Worker& other = *workers[(self + offset) % workers.size()];
+            std::lock_guard<std::mutex> lock(other.mutex);
+            if (!other.ready.empty()) return true;
+        }
+        return false;
+    }
+
+    SymbolBook* popOwn(Worker& worker) {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.ready.empty()) return nullptr;
+        SymbolBook* symbol = worker.ready.front();
+        worker.ready.pop_front();
+        return symbol;
+    }
+
+    // Takes the most recently queued symbol from the first victim that has one
+    SymbolBook* steal(size_t self) {
+        for (size_t offset = 1; offset < workers.size(); ++offset) {
+            Worker& victim = *workers[(self + offset) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.ready.empty()) continue;
+            SymbolBook* symbol = victim.ready.back();
+            victim.ready.pop_back();
+            return symbol;
+        }
+        return nullptr;
+    }
+
+    // Uncrosses symbols until none are left to claim
+    void joinAuction(size_t self) {
+        const size_t chunk = 16;
+        std::ostringstream& output = workers[self]->auctionOutput;
+        for (size_t first = auctionNext.fetch_add(chunk); first < symbols.size(); first = auctionNext.fetch_add(chunk)) {
+            size_t last = std::min(first + chunk, symbols.size());
+            for (size_t i = first; i < last; ++i) {
+                SymbolBook& symbol = *symbols[i];
+                std::streamoff begin = output.tellp();
+                if (symbol.book.inAuction()) symbol.opening = symbol.book.uncross(output);
+                auctionSlices[i] = AuctionSlice{self, begin, static_cast<std::streamoff>(output.tellp())};
+            }
+            if ((auctionDone += last - first) == symbols.size()) wake(idle, true);
+        }
+    }
+
+    void runWorker(size_t self) {
+        Worker& worker = *workers[self];
+        std::vector<Order> batch;
+        while (true) {
+            if (auctionRunning) joinAuction(self);
+            SymbolBook* symbol = popOwn(worker);
+            if (!symbol && stealing) {
+                symbol = steal(self);
+                if (symbol) ++worker.steals;
+            }
+            if (!symbol) {
+                std::unique_lock<std::mutex> lock(idleMutex);
+                wakeup.wait(lock, [&] { return (closing && pendingSymbols == 0) || hasWork(self); });
+                if (closing && pendingSymbols == 0) return;
+                continue;
+            }
+
+            batch.clear();
+            {
+                std::lock_guard<std::mutex> lock(symbol->inboxMutex);
+                while (!symbol->inbox.empty() && batch.size() < batchSize) {
+                    batch.push_back(std::move(symbol->inbox.front()));
+                    symbol->inbox.pop_front();
+                }
+                if (batch.empty()) {
+                    symbol->scheduled = false;
+                    if (symbol->movingTo != SymbolBook::noMove) {
+                        symbol->home = symbol->movingTo;  // Quiescent: hand the symbol over
+                        symbol->movingTo = SymbolBook::noMove;
+                        ++migrationsDone;
+                    }
+                }
+            }
+            if (batch.empty()) {
+                if (--pendingSymbols == 0) {
+                    wake(idle, true);
+                    if (closing) wake(wakeup, true);  // The last one out lets the others stop
+                }
+                continue;
+            }
+            symbol->book.submitBatch(batch.data(), batch.size(), symbol->output);
+            symbol->processed += static_cast<long long>(batch.size());
+            worker.orders += static_cast<long long>(batch.size());
+            // Still scheduled: back of our own queue so other symbols get a turn
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.ready.push_back(symbol);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef TRADE_STORE_H
+#define TRADE_STORE_H
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "orderbook.h"
+
+// Filter for tape queries: inclusive time and price ranges (defaults match everything)
+struct TradeQuery {
+    int fromTime = std::numeric_limits<int>::min();
+    int toTime = std::numeric_limits<int>::max();
+    double minPrice = -std::numeric_limits<double>::infinity();
+    double maxPrice = std::numeric_limits<double>::infinity();
+
+    bool matches(int timestamp, double price) const {
+        return timestamp >= fromTime && timestamp <= toTime && price >= minPrice && price <= maxPrice;
+    }
+};
+
+// Aggregates returned by TradeStore::summarize
+struct TradeStats {
+    long long count = 0;
+    long long volume = 0;
+    double notional = 0.0;
+
+    double vwap() const { return volume > 0 ? notional / volume : 0.0; }
+};
+
+// Append-only in-memory record of every fill, kept in fixed-size columnar chunks.
+// Each chunk carries its time/price bounds and totals, so range queries skip chunks
+// that cannot match and take chunks that fully match from the totals alone.
+class TradeStore {
+public:
+    static constexpr size_t chunkSize = 4096;
+
+private:
+    struct Chunk {
+        std::vector<int> timestamps;
+        std::vector<double> prices;
+        std::vector<int> quantities;
+        std::vector<std::string> buyIds;
+        std::vector<std::string> sellIds;
+
+        int minTime = std::numeric_limits<int>::max();
+        int maxTime = std::numeric_limits<int>::min();
+        double minPrice = std::numeric_limits<double>::infinity();
+        double maxPrice = -std::numeric_limits<double>::infinity();
+        TradeStats totals;
+
+        size_t size() const { return timestamps.size(); }
+
+        bool disjointFrom(const TradeQuery& q) const {
+            return maxTime < q.fromTime || minTime > q.toTime || maxPrice < q.minPrice || minPrice > q.maxPrice;
+        }
+
+        bool containedIn(const TradeQuery& q) const {
+            return minTime >= q.fromTime && maxTime <= q.toTime && minPrice >= q.minPrice && maxPrice <= q.maxPrice;
+        }
+    };
+
+    std::vector<Chunk> chunks;
+
+public:
+    // Hooks the store up to a book so every execution is recorded
+    void attach(OrderBook& book) {
+        book.addFillListener([this](const Fill& fill) { append(fill); });
+    }
+
+    void append(const Fill& fill) {
+        if (chunks.empty() || chunks.back().size() == chunkSize) {
+            chunks.emplace_back();
+            Chunk& fresh = chunks.back();
+            fresh.timestamps.reserve(chunkSize);
+            fresh.prices.reserve(chunkSize);
+            fresh.quantities.reserve(chunkSize);
+            fresh.buyIds.reserve(chunkSize);
+            fresh.sellIds.reserve(chunkSize);
+        }
+        Chunk& chunk = chunks.back();
+        chunk.timestamps.push_back(fill.timestamp);
+        chunk.prices.push_back(fill.price);
+        chunk.quantities.push_back(fill.quantity);
+        chunk.buyIds.push_back(fill.buyId);
+        chunk.sellIds.push_back(fill.sellId);
+
+        chunk.minTime = std::min(chunk.minTime, fill.timestamp);
+        chunk.maxTime = std::max(chunk.maxTime, fill.timestamp);
+        chunk.minPrice = std::min(chunk.minPrice, fill.price);
+        chunk.maxPrice = std::max(chunk.maxPrice, fill.price);
+        chunk.totals.count += 1;
+        chunk.totals.volume += fill.quantity;
+        chunk.totals.notional += fill.price * fill.quantity;
+    }
+
+    size_t size() const {
+        return chunks.empty() ? 0 : (chunks.size() - 1) * chunkSize + chunks.back().size();
+    }
+
+    // Trade count, volume and VWAP over everything matching the query
+    TradeStats summarize(const TradeQuery& query = TradeQuery()) const {
+        TradeStats stats;
+        for (const auto& chunk : chunks) {
+            if (chunk.disjointFrom(query)) continue;
+            if (chunk.containedIn(query)) {
+                stats.count += chunk.totals.count;
+                stats.volume += chunk.totals.volume;
+                stats.notional += chunk.totals.notional;
+                continue;
+            }
+            for (size_t i = 0; i < chunk.size(); ++i) {
+                if (!query.matches(chunk.timestamps[i], chunk.prices[i])) continue;
+                stats.count += 1;
+                stats.volume += chunk.quantities[i];
+                stats.notional += chunk.prices[i] * chunk.quantities[i];
+            }
+        }
+        return stats;
+    }
+
+    // The most recent n trades matching the query, oldest first
+    std::vector<Fill> lastTrades(size_t n, const TradeQuery& query = TradeQuery()) const {
+        std::vector<Fill> trades;
+        for (auto chunk = chunks.rbegin(); chunk != chunks.rend() && trades.size() < n; ++chunk) {
+            if (chunk->disjointFrom(query)) continue;
+            for (size_t i = chunk->size(); i-- > 0 && trades.size() < n;) {
+                if (!query.matches(chunk->timestamps[i], chunk->prices[i])) continue;
+                trades.push_back({chunk->buyIds[i], chunk->sellIds[i], chunk->quantities[i],
+                                  chunk->prices[i], chunk->timestamps[i]});
+            }
+        }
+        std::reverse(trades.begin(), trades.end());
+        return trades;
+    }
+};
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef TSC_CLOCK_H
+#define TSC_CLOCK_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+// Cheap timestamps for instrumentation. On x86 with an invariant TSC (constant rate
+// across frequency changes and sleep states, advertised in CPUID 0x80000007 EDX bit 8)
+// now() is a bare rdtsc, a few nanoseconds; the tick rate is calibrated once against
+// steady_clock the first time the clock is used. Anywhere else now() falls back to
+// steady_clock in nanoseconds. Either way, differences of now() convert with
+// nanoseconds()/seconds().
+//
+// rdtsc is not ordered with the surrounding instructions; nowOrdered() (rdtscp) waits
+// for everything before it to finish and is the one to end a measured interval with.
+class TscClock {
+    struct Calibration {
+        bool useTsc = false;
+        double nanosPerTick = 1.0;
+    };
+
+public:
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        if (calibration().useTsc) return __rdtsc();
+#endif
+        return steadyNanos();
+    }
+
+    static uint64_t nowOrdered() {
+#if defined(__x86_64__) || defined(__i386__)
+        if (calibration().useTsc) {
+            unsigned int processor;
+            return __rdtscp(&processor);
+        }
+#endif
+        return steadyNanos();
+    }
+
+    static double nanoseconds(uint64_t ticks) { return ticks * calibration().nanosPerTick; }
+    static double seconds(uint64_t ticks) { return nanoseconds(ticks) * 1e-9; }
+
+    // True if now() reads the TSC rather than steady_clock
+    static bool usingTsc() { return calibration().useTsc; }
+
+    // Forces the one-off calibration (about 10 ms) now rather than on first use
+    static void calibrate() { calibration(); }
+
+private:
+    static uint64_t steadyNanos() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    static bool invariantTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007) return false;
+        if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+        return (edx & (1u << 8)) != 0;
+#else
+        return false;
+#endif
+    }
+
+    static const Calibration& calibration() {
+        static const Calibration result = [] {
+            Calibration measured;
+#if defined(__x86_64__) || defined(__i386__)
+            if (!invariantTsc()) return measured;
+            uint64_t startNanos = steadyNanos();
+            uint64_t startTicks = __rdtsc();
+            uint64_t endNanos;
+            do {
+                endNanos = steadyNanos();
+            } while (endNanos - startNanos < 10000000);
+            uint64_t endTicks = __rdtsc();
+            if (endTicks > startTicks) {
+                measured.useTsc = true;
+                measured.nanosPerTick = static_cast<double>(endNanos - startNanos) / (endTicks - startTicks);
+            }
+#endif
+            return measured;
+        }();
+        return result;
+    }
+};
+
+// Latency histogram in nanoseconds with log-linear buckets: exact below 16 ns, then 16
+// buckets per power of two (at most 1/16 relative error). record() is a couple of shifts
+// and an increment, cheap enough for every order.
+class LatencyHistogram {
+    static constexpr int subBits = 4;
+    static constexpr uint64_t subBuckets = 1u << subBits;
+
+    std::array<uint64_t, (64 - subBits + 1) * subBuckets> counts{};
+    uint64_t total = 0;
+    uint64_t largest = 0;
+
+public:
+    void record(uint64_t nanos) {
+        ++counts[bucketOf(nanos)];
+        ++total;
+        if (nanos > largest) largest = nanos;
+    }
+
+    // Records the time between two TscClock readings
+    void recordTicks(uint64_t start, uint64_t end) { recordTicks(end - start); }
+
+    // Records a duration in TscClock ticks (e.g. several intervals added up)
+    void recordTicks(uint64_t ticks) { record(static_cast<uint64_t>(TscClock::nanoseconds(ticks))); }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return largest; }
+
+    // Upper bound of the bucket holding the p-th percentile (p in 0..100)
+    uint64_t percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t index = 0; index < counts.size(); ++index) {
+            seen += counts[index];
+            if (seen >= rank) return std::min(upperBound(index), largest);
+        }
+        return largest;
+    }
+
+private:
+    static size_t bucketOf(uint64_t value) {
+        if (value < subBuckets) return static_cast<size_t>(value);
+        int shift = 63 - __builtin_clzll(value) - subBits;
+        return static_cast<size_t>((shift + 1) * subBuckets + ((value >> shift) - subBuckets));
+    }
+
+    static uint64_t upperBound(size_t index) {
+        if (index < subBuckets) return index;
+        int shift = static_cast<int>(index / subBuckets) - 1;
+        uint64_t lower = (subBuckets + index % subBuckets) << shift;
+        return lower + ((uint64_t{1} << shift) - 1);
+    }
+};
+
+#endif